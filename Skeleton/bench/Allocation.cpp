@@ -0,0 +1,109 @@
+#include "ObjectPool.h"
+#include "Scenario.h"
+#include "Simulation.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+using namespace std;
+
+// The counting operator new below is malloc based on purpose
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+// Counts heap allocations and times each phase of a simulation's life, once
+// with the object pool and once with SPL_POOL=0, which sends every facility,
+// settlement and action to the global heap as before the pool existed.
+// usage: bench_Allocation [plans] [steps] [commands]
+
+static atomic<size_t> heapAllocations(0);
+
+void *operator new(size_t size)
+{
+    ++heapAllocations;
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+static string writeScenario(int numPlans)
+{
+    string path = "bench_allocation_config.txt";
+    Scenario scenario;
+    scenario.settlements = numPlans / 4 + 1;
+    scenario.plans = numPlans;
+    scenario.writeFile(path);
+    return path;
+}
+
+// Runs fn and prints one CSV row with its heap allocations and time
+template <typename Function>
+static void phase(const char *name, long operations, Function fn)
+{
+    size_t before = heapAllocations;
+    auto begin = chrono::steady_clock::now();
+    fn();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    size_t allocations = heapAllocations - before;
+    printf("%s,%s,%ld,%zu,%.4f,%.0f\n", ObjectPool::isEnabled() ? "pool" : "heap", name, operations, allocations, seconds, operations / seconds);
+}
+
+static void measure(int numPlans, int numSteps, int numCommands)
+{
+    string config = writeScenario(numPlans);
+    Simulation *simulation = nullptr;
+    Simulation *backup = nullptr;
+    phase("load", numPlans, [&]
+          { simulation = new Simulation(config); simulation->open(); });
+    phase("step", static_cast<long>(numSteps) * numPlans, [&]
+          { for (int i = 0; i < numSteps; ++i) simulation->step(1); });
+    // The first step after a backup copies every plan with its facilities
+    phase("backup_step", numPlans, [&]
+          { backup = new Simulation(*simulation); simulation->step(1); });
+    phase("commands", numCommands, [&]
+          { for (int i = 0; i < numCommands; ++i) simulation->processCommand("settlement Extra" + to_string(i) + " 1"); });
+    phase("teardown", numPlans, [&]
+          { delete backup; delete simulation; });
+    remove(config.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    int numPlans = argc > 1 ? atoi(argv[1]) : 20000;
+    int numSteps = argc > 2 ? atoi(argv[2]) : 100;
+    int numCommands = argc > 3 ? atoi(argv[3]) : 100000;
+    if (getenv("BENCH_ALLOCATION_CHILD") != nullptr)
+    {
+        measure(numPlans, numSteps, numCommands);
+        return 0;
+    }
+
+    // The pool reads SPL_POOL once per process, so each mode runs in its own child
+    printf("mode,phase,operations,heap_allocations,seconds,operations_per_second\n");
+    fflush(stdout);
+    for (const char *pool : {"0", "1"})
+    {
+        string command = string("BENCH_ALLOCATION_CHILD=1 SPL_POOL=") + pool + " " + argv[0] + " " + to_string(numPlans) + " " + to_string(numSteps) + " " + to_string(numCommands);
+        if (system(command.c_str()) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "BalancedKernel.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Times the BalancedSelection argmin kernel for every implementation the CPU
+// supports over growing catalogs, and checks each one picks the same facility
+// as the scalar loop.
+// usage: bench_BalancedSelection [max_catalog_size] [selections]
+
+int main(int argc, char **argv)
+{
+    size_t maxCatalogSize = argc > 1 ? stoul(argv[1]) : 1 << 20;
+    long selections = argc > 2 ? stol(argv[2]) : 1 << 24; // Facilities scanned per size and implementation
+    const BalancedKernel::Implementation implementations[] = {BalancedKernel::Implementation::SCALAR, BalancedKernel::Implementation::SSE41, BalancedKernel::Implementation::AVX2};
+
+    mt19937 random(42);
+    vector<int> life(maxCatalogSize), eco(maxCatalogSize), env(maxCatalogSize);
+    for (size_t i = 0; i < maxCatalogSize; ++i)
+    {
+        life[i] = random() % 6;
+        eco[i] = random() % 6;
+        env[i] = random() % 6;
+    }
+
+    printf("implementation,catalog,selections,seconds,facilities_per_second,speedup,identical\n");
+    for (size_t catalogSize = 16; catalogSize <= maxCatalogSize; catalogSize *= 4)
+    {
+        long rounds = max(1L, selections / static_cast<long>(catalogSize));
+        double scalarSeconds = 0;
+        vector<size_t> scalarPicks;
+        for (BalancedKernel::Implementation implementation : implementations)
+        {
+            if (!BalancedKernel::isSupported(implementation))
+            {
+                continue;
+            }
+            // Running scores drift like a real plan's, so the winner keeps moving
+            vector<size_t> picks;
+            int lifeScore = 0, ecoScore = 0, envScore = 0;
+            auto begin = chrono::steady_clock::now();
+            for (long round = 0; round < rounds; ++round)
+            {
+                size_t pick = BalancedKernel::findMostBalanced(implementation, life.data(), eco.data(), env.data(), catalogSize, lifeScore, ecoScore, envScore);
+                lifeScore += life[pick];
+                ecoScore += eco[pick];
+                envScore += env[pick];
+                picks.push_back(pick);
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            if (implementation == BalancedKernel::Implementation::SCALAR)
+            {
+                scalarSeconds = seconds;
+                scalarPicks = picks;
+            }
+            printf("%s,%zu,%ld,%.6f,%.0f,%.2f,%s\n", BalancedKernel::toString(implementation), catalogSize, rounds, seconds,
+                   rounds * static_cast<double>(catalogSize) / seconds, scalarSeconds / seconds, picks == scalarPicks ? "yes" : "NO");
+        }
+    }
+    return 0;
+}
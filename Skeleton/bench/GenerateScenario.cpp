@@ -0,0 +1,32 @@
+#include "Scenario.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Writes a synthetic config to standard output, see Scenario.h.
+// usage: bench_GenerateScenario [settlements] [facilities] [plans] [nve:bal:eco:env] [seed]
+
+int main(int argc, char **argv)
+{
+    Scenario scenario;
+    try
+    {
+        scenario.settlements = argc > 1 ? stoi(argv[1]) : scenario.settlements;
+        scenario.facilities = argc > 2 ? stoi(argv[2]) : scenario.facilities;
+        scenario.plans = argc > 3 ? stoi(argv[3]) : scenario.plans;
+        scenario.seed = argc > 5 ? static_cast<unsigned>(stoul(argv[5])) : scenario.seed;
+    }
+    catch (const exception &)
+    {
+        fprintf(stderr, "usage: bench_GenerateScenario [settlements] [facilities] [plans] [nve:bal:eco:env] [seed]\n");
+        return 1;
+    }
+    if ((argc > 4 && !scenario.parseMix(argv[4])) || scenario.settlements < 0 || scenario.facilities < 0 || scenario.plans < 0)
+    {
+        fprintf(stderr, "usage: bench_GenerateScenario [settlements] [facilities] [plans] [nve:bal:eco:env] [seed]\n");
+        return 1;
+    }
+    scenario.write(cout);
+    return cout ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+using std::string;
+
+// Synthetic configs in the config_file.txt grammar, shared by the benchmarks.
+// The same options and seed always produce the same file.
+struct Scenario
+{
+    int settlements = 5000;
+    int facilities = 60;
+    int plans = 20000;
+    // Relative weights of the policies plans are created with
+    int naiveWeight = 0;
+    int balancedWeight = 1;
+    int economyWeight = 1;
+    int sustainabilityWeight = 1;
+    unsigned seed = 42;
+
+    // Reads "nve:bal:eco:env" weights such as "0:1:1:1", false if malformed
+    bool parseMix(const string &mix)
+    {
+        int weights[4];
+        char separators[3];
+        int fields = std::sscanf(mix.c_str(), "%d%c%d%c%d%c%d", &weights[0], &separators[0], &weights[1], &separators[1], &weights[2], &separators[2], &weights[3]);
+        if (fields != 7 || separators[0] != ':' || separators[1] != ':' || separators[2] != ':')
+        {
+            return false;
+        }
+        if (weights[0] < 0 || weights[1] < 0 || weights[2] < 0 || weights[3] < 0 || weights[0] + weights[1] + weights[2] + weights[3] == 0)
+        {
+            return false;
+        }
+        naiveWeight = weights[0];
+        balancedWeight = weights[1];
+        economyWeight = weights[2];
+        sustainabilityWeight = weights[3];
+        return true;
+    }
+
+    void write(std::ostream &out) const
+    {
+        std::mt19937 random(seed);
+        out << "# settlement <settlement_name> <settlement_type>\n";
+        for (int i = 0; i < settlements; ++i)
+        {
+            out << "settlement S" << i << " " << random() % 3 << "\n";
+        }
+        // Every category gets facilities, so category policies always have a choice
+        out << "# facility <facility_name> <category> <price> <lifeq_impact> <eco_impact> <env_impact>\n";
+        for (int i = 0; i < facilities; ++i)
+        {
+            out << "facility F" << i << " " << i % 3 << " " << 1 + random() % 6 << " " << random() % 6 << " " << random() % 6 << " " << random() % 6 << "\n";
+        }
+        out << "# plan <settlement_name> <selection_policy>\n";
+        const char *policies[] = {"nve", "bal", "eco", "env"};
+        std::discrete_distribution<int> policy({static_cast<double>(naiveWeight), static_cast<double>(balancedWeight), static_cast<double>(economyWeight), static_cast<double>(sustainabilityWeight)});
+        for (int i = 0; i < plans && settlements > 0; ++i)
+        {
+            out << "plan S" << random() % settlements << " " << policies[policy(random)] << "\n";
+        }
+    }
+
+    void writeFile(const string &path) const
+    {
+        std::ofstream out(path);
+        write(out);
+        if (!out)
+        {
+            throw std::runtime_error("Could not write " + path);
+        }
+    }
+};
@@ -0,0 +1,74 @@
+#include "Scenario.h"
+#include "Simulation.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Times `step` on one simulation per thread count, from 1 to all cores, and
+// checks that every parallel run ends in the same scores as the serial one.
+// usage: bench_step [plans] [steps]
+
+static string writeScenario(int numPlans)
+{
+    string path = "bench_step_config.txt";
+    Scenario scenario;
+    scenario.settlements = numPlans / 4 + 1;
+    scenario.plans = numPlans;
+    scenario.writeFile(path);
+    return path;
+}
+
+static string finalScores(Simulation &simulation, int numPlans)
+{
+    string scores;
+    for (int i = 0; i < numPlans; ++i)
+    {
+        scores += simulation.getPlan(i).toString();
+    }
+    return scores;
+}
+
+int main(int argc, char **argv)
+{
+    int numPlans = argc > 1 ? stoi(argv[1]) : 20000;
+    int numSteps = argc > 2 ? stoi(argv[2]) : 200;
+    int maxThreads = max(1u, thread::hardware_concurrency());
+    string config = writeScenario(numPlans);
+
+    string serialScores;
+    double serialSeconds = 0;
+    printf("threads,plans,steps,seconds,speedup,identical\n");
+    vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads = threads < 4 ? threads + 1 : threads * 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts)
+    {
+        Simulation simulation(config);
+        simulation.open();
+        auto begin = chrono::steady_clock::now();
+        for (int i = 0; i < numSteps; ++i)
+        {
+            simulation.step(threads);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        string scores = finalScores(simulation, numPlans);
+        if (threads == 1)
+        {
+            serialScores = scores;
+            serialSeconds = seconds;
+        }
+        printf("%d,%d,%d,%.4f,%.2f,%s\n", threads, numPlans, numSteps, seconds, serialSeconds / seconds, scores == serialScores ? "yes" : "NO");
+    }
+    remove(config.c_str());
+    return 0;
+}
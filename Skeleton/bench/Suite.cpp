@@ -0,0 +1,222 @@
+#include "Scenario.h"
+#include "Auxiliary.h"
+#include "SelectionPolicy.h"
+#include "Simulation.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Times the main operations of the simulation on one generated scenario and
+// prints a CSV row per benchmark. Saving the output of one commit and passing
+// it as --baseline on another adds the old throughput and the ratio.
+// usage: bench_Suite [--settlements n] [--facilities n] [--plans n] [--mix nve:bal:eco:env]
+//                    [--seed n] [--steps n] [--selections n] [--commands n]
+//                    [--label name] [--baseline results.csv]
+
+struct Result
+{
+    string benchmark;
+    long operations;
+    double seconds;
+};
+
+// Swallows output without formatting it twice, so printing is what gets timed
+class DiscardBuffer : public streambuf
+{
+public:
+    DiscardBuffer() : buffer()
+    {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+protected:
+    int overflow(int c) override
+    {
+        setp(buffer, buffer + sizeof(buffer));
+        return c == traits_type::eof() ? traits_type::not_eof(c) : c;
+    }
+
+    streamsize xsputn(const char *, streamsize count) override
+    {
+        return count;
+    }
+
+private:
+    char buffer[4096];
+};
+
+static volatile size_t selectionSink; // Keeps the selections from being optimized away
+
+template <typename Function>
+static double timeIt(Function fn)
+{
+    auto begin = chrono::steady_clock::now();
+    fn();
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+// Operations per second by benchmark, from the CSV this program prints
+static map<string, double> readBaseline(const string &path)
+{
+    map<string, double> throughput;
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        throw runtime_error("Could not open baseline " + path);
+    }
+    string line;
+    getline(in, line); // Header
+    while (getline(in, line))
+    {
+        vector<string> fields;
+        stringstream row(line);
+        string field;
+        while (getline(row, field, ','))
+        {
+            fields.push_back(field);
+        }
+        if (fields.size() >= 5)
+        {
+            throughput[fields[1]] = stod(fields[4]);
+        }
+    }
+    return throughput;
+}
+
+int main(int argc, char **argv)
+{
+    Scenario scenario;
+    int steps = 100;
+    long selections = 1000000;
+    int commands = 20000;
+    string label = "current";
+    string baselinePath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        string value = argv[i + 1];
+        if (option == "--settlements")
+            scenario.settlements = stoi(value);
+        else if (option == "--facilities")
+            scenario.facilities = stoi(value);
+        else if (option == "--plans")
+            scenario.plans = stoi(value);
+        else if (option == "--mix" && scenario.parseMix(value))
+            continue;
+        else if (option == "--seed")
+            scenario.seed = static_cast<unsigned>(stoul(value));
+        else if (option == "--steps")
+            steps = stoi(value);
+        else if (option == "--selections")
+            selections = stol(value);
+        else if (option == "--commands")
+            commands = stoi(value);
+        else if (option == "--label")
+            label = value;
+        else if (option == "--baseline")
+            baselinePath = value;
+        else
+        {
+            fprintf(stderr, "Unknown or malformed option %s\n", option.c_str());
+            return 1;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        fprintf(stderr, "Option %s needs a value\n", argv[argc - 1]);
+        return 1;
+    }
+    map<string, double> baseline = baselinePath.empty() ? map<string, double>() : readBaseline(baselinePath);
+
+    string config = "bench_suite_config.txt";
+    scenario.writeFile(config);
+    vector<Result> results;
+    DiscardBuffer discard;
+    ostream discarded(&discard);
+    streambuf *standardOutput = cout.rdbuf();
+    streambuf *standardError = cerr.rdbuf();
+
+    // Config load, counted in config lines
+    unique_ptr<Simulation> simulation;
+    double seconds = timeIt([&]
+                            { simulation.reset(new Simulation(config)); });
+    results.push_back({"config_load", static_cast<long>(simulation->getConfigLoadStats().lines), seconds});
+    simulation->open();
+
+    // Stepping, counted in plan steps
+    seconds = timeIt([&]
+                     { for (int i = 0; i < steps; ++i) simulation->step(1); });
+    results.push_back({"step", static_cast<long>(steps) * scenario.plans, seconds});
+    seconds = timeIt([&]
+                     { simulation->fastForward(steps, 1); });
+    results.push_back({"fast_forward", static_cast<long>(steps) * scenario.plans, seconds});
+
+    // Each policy on its own, against the scenario's catalog
+    const FacilityCatalog &catalog = simulation->getFacilityCatalog();
+    for (const char *name : {"nve", "bal", "eco", "env"})
+    {
+        unique_ptr<SelectionPolicy> policy(Auxiliary::createSelectionPolicy(name));
+        if (!policy->canSelect(catalog))
+        {
+            continue;
+        }
+        size_t checksum = 0;
+        seconds = timeIt([&]
+                         { for (long i = 0; i < selections; ++i) checksum += policy->selectFacility(catalog); });
+        selectionSink = checksum;
+        results.push_back({string("select_") + name, selections, seconds});
+    }
+
+    // Backup and restore around a change to one plan, so both copy on write
+    cout.rdbuf(&discard);
+    cerr.rdbuf(&discard);
+    double backupSeconds = 0, restoreSeconds = 0;
+    const char *policies[] = {"nve", "eco"};
+    for (int i = 0; i < commands; ++i)
+    {
+        backupSeconds += timeIt([&]
+                                { simulation->processCommand("backup"); });
+        simulation->processCommand(string("changePolicy 0 ") + policies[i % 2]);
+        restoreSeconds += timeIt([&]
+                                 { simulation->processCommand("restore"); });
+    }
+    cout.rdbuf(standardOutput);
+    cerr.rdbuf(standardError);
+    results.push_back({"backup", commands, backupSeconds});
+    results.push_back({"restore", commands, restoreSeconds});
+
+    // Printing the log the commands above left, counted in entries
+    long entries = static_cast<long>(simulation->getActionsLog().size());
+    seconds = timeIt([&]
+                     { simulation->getActionsLog().print(discarded); });
+    results.push_back({"log_print", entries, seconds});
+    remove(config.c_str());
+
+    printf("label,benchmark,operations,seconds,operations_per_second%s\n", baseline.empty() ? "" : ",baseline_operations_per_second,ratio");
+    for (const Result &result : results)
+    {
+        double throughput = result.seconds > 0 ? result.operations / result.seconds : 0;
+        printf("%s,%s,%ld,%.6f,%.0f", label.c_str(), result.benchmark.c_str(), result.operations, result.seconds, throughput);
+        if (!baseline.empty())
+        {
+            auto found = baseline.find(result.benchmark);
+            if (found != baseline.end() && found->second > 0)
+            {
+                printf(",%.0f,%.3f", found->second, throughput / found->second);
+            }
+            else
+            {
+                printf(",,");
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -1,6 +1,8 @@
 #pragma once
+#include <map>
 #include <string>
 #include <vector>
+#include "ObjectPool.h"
 #include "Simulation.h"
 enum class SettlementType : unsigned int;
 enum class FacilityCategory;
@@ -11,13 +13,19 @@ enum class ActionStatus
     ERROR
 };
 
-class BaseAction
+string actionStatusToString(ActionStatus status);
+
+// Named backups. Copying a Simulation shares its state, so a backup costs O(1)
+extern std::map<string, Simulation> backups;
+
+class BaseAction : public PooledObject
 {
 public:
     BaseAction();
     ActionStatus getStatus() const;
     virtual void act(Simulation &simulation) = 0;
     virtual const string toString() const = 0;
+    virtual void appendTo(ActionLog &log) const = 0; // Writes the words of toString(), without the status, as a log entry
     virtual BaseAction *clone() const = 0;
     virtual ~BaseAction() = default;
 
@@ -36,12 +44,15 @@ class SimulateStep : public BaseAction
 
 public:
     SimulateStep(const int numOfSteps);
+    SimulateStep(const int numOfSteps, const int numOfThreads);
     void act(Simulation &simulation) override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
     SimulateStep *clone() const override;
 
 private:
     const int numOfSteps;
+    const int numOfThreads; // 0 means the simulation's default
 };
 
 class AddPlan : public BaseAction
@@ -50,6 +61,7 @@ public:
     AddPlan(const string &settlementName, const string &selectionPolicy);
     void act(Simulation &simulation) override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
     AddPlan *clone() const override;
 
 private:
@@ -64,6 +76,7 @@ public:
     void act(Simulation &simulation) override;
     AddSettlement *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
     const string settlementName;
@@ -77,6 +90,7 @@ public:
     void act(Simulation &simulation) override;
     AddFacility *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
     const string facilityName;
@@ -90,13 +104,15 @@ private:
 class PrintPlanStatus : public BaseAction
 {
 public:
-    PrintPlanStatus(int planId);
+    PrintPlanStatus(int planId, bool summary = false);
     void act(Simulation &simulation) override;
     PrintPlanStatus *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
     const int planId;
+    const bool summary;
 };
 
 class ChangePlanPolicy : public BaseAction
@@ -106,6 +122,7 @@ public:
     void act(Simulation &simulation) override;
     ChangePlanPolicy *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
     const int planId;
@@ -119,6 +136,7 @@ public:
     void act(Simulation &simulation) override;
     PrintActionsLog *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
 };
@@ -130,6 +148,7 @@ public:
     void act(Simulation &simulation) override;
     Close *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
 };
@@ -138,20 +157,114 @@ class BackupSimulation : public BaseAction
 {
 public:
     BackupSimulation();
+    BackupSimulation(const string &backupName);
     void act(Simulation &simulation) override;
     BackupSimulation *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
+    const string backupName; // Empty for the default backup
 };
 
 class RestoreSimulation : public BaseAction
 {
 public:
     RestoreSimulation();
+    RestoreSimulation(const string &backupName);
     void act(Simulation &simulation) override;
     RestoreSimulation *clone() const override;
     const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const string backupName; // Empty for the default backup
+};
+
+class SaveSimulation : public BaseAction
+{
+public:
+    SaveSimulation(const string &filePath);
+    void act(Simulation &simulation) override;
+    SaveSimulation *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const string filePath;
+};
+
+class LoadSimulation : public BaseAction
+{
+public:
+    LoadSimulation(const string &filePath);
+    void act(Simulation &simulation) override;
+    LoadSimulation *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const string filePath;
+};
+
+class PrintStats : public BaseAction
+{
+public:
+    PrintStats(bool reset = false);
+    void act(Simulation &simulation) override;
+    PrintStats *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const bool reset; // Clears the statistics instead of printing them
+};
+
+class Trace : public BaseAction
+{
+public:
+    Trace();                       // Starts tracing
+    Trace(const string &filePath); // Stops tracing and writes the trace to filePath
+    void act(Simulation &simulation) override;
+    Trace *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
 
 private:
-};
\ No newline at end of file
+    const string filePath; // Empty when starting
+};
+
+class Profile : public BaseAction
+{
+public:
+    enum class Request
+    {
+        PRINT,
+        START,
+        STOP,
+        RESET,
+    };
+
+    Profile(Request request);
+    void act(Simulation &simulation) override;
+    Profile *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const Request request;
+};
+
+class AdvisePolicy : public BaseAction
+{
+public:
+    AdvisePolicy(const int planId, const int numOfSteps);
+    void act(Simulation &simulation) override;
+    AdvisePolicy *clone() const override;
+    const string toString() const override;
+    void appendTo(ActionLog &log) const override;
+
+private:
+    const int planId;
+    const int numOfSteps;
+};
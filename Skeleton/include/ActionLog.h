@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Snapshot.h"
+using std::string;
+using std::vector;
+
+enum class ActionStatus;
+
+// The log of executed actions as a compact append-only byte buffer. An entry
+// is written by the action itself, one field at a time: a number is stored as
+// a varint, any other word is interned once and stored as the varint of its
+// id, and a last varint holds the status. Nothing formats a line on the way
+// in. Once the buffer passes the spill threshold it is moved to an unlinked
+// temporary file, so memory holds the newest entries and the interned words
+// only. The threshold comes from SPL_LOG_SPILL (bytes, DefaultSpillThreshold
+// if unset).
+// Copying a log is O(1): copies share the interned words, whose ids never
+// change, the buffer up to the point they parted and what was spilled before
+// that. All three are only appended to, and a copy that finds someone else
+// appended past its own end goes on in a buffer or file of its own. Copies
+// must not be appended to from different threads at once.
+class ActionLog
+{
+public:
+    static const size_t DefaultSpillThreshold = 256 * 1024; // Bounds the buffer a diverging copy has to copy
+
+    ActionLog();
+    explicit ActionLog(size_t spillThreshold);
+
+    // An entry is beginEntry(), the action's words and numbers, then endEntry()
+    void beginEntry();
+    void appendWord(const char *word);
+    void appendWord(const string &word);
+    void appendNumber(long long value);
+    void endEntry(ActionStatus status);
+    void append(const string &command, ActionStatus status); // A whole entry, split into words at spaces
+    size_t size() const; // Entries
+    size_t getBufferedBytes() const; // Encoded entries still in memory
+    uint64_t getSpilledBytes() const;
+    // Decodes the entries oldest first, reading the spilled part one segment at a time
+    void forEach(const std::function<void(const string &command, ActionStatus status)> &visit) const;
+    void print(std::ostream &out) const; // One "<command> <STATUS>" line per entry
+
+private:
+    class SpillFile;
+    class WordTable;
+
+    // Low two bits of every varint in an entry
+    static const uint64_t WordField = 0;
+    static const uint64_t NumberField = 1;
+    static const uint64_t CompletedEnd = 2;
+    static const uint64_t ErrorEnd = 3;
+
+    size_t spillThreshold;
+    size_t count;
+    std::shared_ptr<SnapshotWriter> buffer; // Entries not spilled yet, this log's part is the first bufferedBytes
+    size_t bufferedBytes;
+    std::shared_ptr<WordTable> words;
+    std::shared_ptr<SpillFile> spill;
+    vector<uint64_t> segments; // Sizes of the spilled buffers, in file order
+    uint64_t spilledBytes;
+
+    void encodeWord(const char *text, size_t length);
+    void decodeEntries(const char *data, size_t size, const std::function<void(const string &command, ActionStatus status)> &visit) const;
+    void spillBuffer();
+};
@@ -7,6 +7,53 @@
 #include "Facility.h"
 #include "SelectionPolicy.h"
 
+// A view of one argument inside a line, valid as long as the line is
+struct Argument
+{
+    const char *data;
+    size_t size;
+
+    bool equals(const char *text) const;
+    std::string toString() const;
+};
+
+// Splits a line into Arguments without copying it.
+// The storage is kept between lines, so parsing does not allocate once warm.
+class ArgumentList
+{
+public:
+    ArgumentList();
+    void parse(const std::string &line);
+    void parse(const char *begin, const char *end);
+    size_t size() const;
+    bool empty() const;
+    const Argument &operator[](size_t index) const;
+
+private:
+    std::vector<Argument> arguments;
+};
+
+enum class CommandType
+{
+    STEP,
+    PLAN,
+    SETTLEMENT,
+    FACILITY,
+    PLAN_STATUS,
+    CHANGE_POLICY,
+    LOG,
+    CLOSE,
+    BACKUP,
+    RESTORE,
+    SAVE,
+    LOAD,
+    STATS,
+    TRACE,
+    PROFILE,
+    ADVISE,
+    UNKNOWN,
+};
+
 class Auxiliary
 {
 public:
@@ -14,4 +61,11 @@ public:
     static SettlementType parseSettlementType(const std::string &type);
     static FacilityCategory parseFacilityCategory(const std::string &category);
     static SelectionPolicy *createSelectionPolicy(const std::string &policy);
+
+    // Non-throwing parsers for the command path, they return false on malformed input
+    static CommandType parseCommand(const Argument &command);
+    static const char *commandName(CommandType type); // The word that starts the command
+    static bool parseInt(const Argument &argument, int &value);
+    static bool parseSettlementType(const Argument &argument, SettlementType &type);
+    static bool parseFacilityCategory(const Argument &argument, FacilityCategory &category);
 };
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Shared memo of BalancedSelection decisions for one catalog version.
+// The facility a balanced policy picks only depends on the differences between
+// its running scores, so plans in the same difference state share one argmin.
+// Keys pack (life - economy, life - environment) as 32 bit wrap-around values,
+// the same arithmetic the kernel uses. Lookups are spread over lock-striped
+// maps so parallel steps rarely contend. A stripe that grows past
+// MaxStripeEntries is emptied, which keeps memory bounded.
+class BalancedDecisionCache
+{
+public:
+    struct Stats
+    {
+        size_t hits;
+        size_t misses;
+        size_t entries;
+        size_t invalidations; // Catalog changes that dropped cached decisions
+    };
+
+    BalancedDecisionCache();
+    explicit BalancedDecisionCache(const Stats &previous); // Replaces a cache the catalog outgrew, keeping its counters
+    BalancedDecisionCache(const BalancedDecisionCache &other) = delete;
+    BalancedDecisionCache &operator=(const BalancedDecisionCache &other) = delete;
+
+    static uint64_t makeKey(int lifeQualityScore, int economyScore, int environmentScore);
+    bool find(uint64_t key, size_t &facilityIndex);
+    void insert(uint64_t key, size_t facilityIndex);
+    void invalidate(); // Drops every decision, not thread-safe
+    Stats getStats() const;
+
+private:
+    static const size_t StripeCount = 16;
+    static const size_t MaxStripeEntries = 1 << 16;
+
+    struct Stripe
+    {
+        Stripe() : lock(), decisions(), hits(0), misses(0) {}
+
+        mutable std::mutex lock;
+        std::unordered_map<uint64_t, size_t> decisions;
+        size_t hits;
+        size_t misses;
+    };
+
+    Stripe stripes[StripeCount];
+    const size_t baseHits;
+    const size_t baseMisses;
+    size_t invalidations;
+
+    Stripe &stripeFor(uint64_t key);
+};
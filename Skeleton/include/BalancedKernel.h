@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// Argmin kernels for BalancedSelection.
+// Given score columns and the plan's running scores, finds the first index i
+// with the smallest max(|l - e|, |l - v|, |e - v|), where l, e and v are the
+// running scores plus the scores of facility i. Every implementation returns
+// the same index as the scalar loop, ties go to the lowest index.
+class BalancedKernel
+{
+public:
+    enum class Implementation
+    {
+        SCALAR,
+        SSE41,
+        AVX2,
+    };
+
+    // Uses the widest implementation the CPU supports
+    static size_t findMostBalanced(const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                   int lifeQualityScore, int economyScore, int environmentScore);
+    static size_t findMostBalanced(Implementation implementation, const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                   int lifeQualityScore, int economyScore, int environmentScore);
+    static bool isSupported(Implementation implementation);
+    static Implementation best();
+    static const char *toString(Implementation implementation);
+};
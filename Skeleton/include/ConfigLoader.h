@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+class Simulation;
+
+struct ConfigLoadStats
+{
+    size_t bytes;
+    size_t lines;
+    int threads;
+    double seconds;
+};
+
+// Loads a config file into a simulation.
+// The file is memory-mapped and split into chunks on line boundaries. The
+// chunks are parsed in parallel into ready-made settlements, facilities and
+// policies, then applied to the simulation one chunk after another, so a plan
+// still needs an earlier settlement and duplicates are still rejected exactly
+// as a line-by-line load would.
+class ConfigLoader
+{
+public:
+    ConfigLoader(const string &configFilePath);
+    ConfigLoadStats loadInto(Simulation &simulation) const;
+
+private:
+    // Files smaller than this are parsed on the calling thread
+    static const size_t MinParallelBytes = 1 << 20;
+
+    const string configFilePath;
+};
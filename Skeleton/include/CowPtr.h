@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+
+// A shared pointer with copy-on-write semantics.
+// Copying a CowPtr only shares the value. The first call to mut() on a copy
+// that is still shared clones the value, so snapshots cost O(1) and only the
+// parts that change afterwards are ever copied.
+// mut() is not thread-safe on the same CowPtr, detach before going parallel.
+template <typename T>
+class CowPtr
+{
+public:
+    CowPtr() : value(std::make_shared<T>()) {}
+    explicit CowPtr(T *value) : value(value) {}
+
+    const T &get() const
+    {
+        return *value;
+    }
+
+    const T &operator*() const
+    {
+        return *value;
+    }
+
+    const T *operator->() const
+    {
+        return value.get();
+    }
+
+    T &mut()
+    {
+        if (value.use_count() > 1)
+        {
+            value = std::make_shared<T>(*value);
+        }
+        return *value;
+    }
+
+    bool isShared() const
+    {
+        return value.use_count() > 1;
+    }
+
+private:
+    std::shared_ptr<T> value;
+};
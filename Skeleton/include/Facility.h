@@ -1,10 +1,13 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include "ObjectPool.h"
 using std::string;
 using std::vector;
 
-enum class FacilityStatus
+enum class FacilityStatus : uint8_t
 {
     UNDER_CONSTRUCTIONS,
     OPERATIONAL,
@@ -37,21 +40,25 @@ protected:
     const int environment_score;
 };
 
-class Facility : public FacilityType
+// A facility a plan builds, kept as a small record: its type is a position in
+// the FacilityCatalog, so names and scores are looked up there when needed.
+// The owning plan knows the settlement.
+class Facility : public PooledObject
 {
 
 public:
-    Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
-    Facility(const FacilityType &type, const string &settlementName);
-    const string &getSettlementName() const;
+    Facility(); // An operational facility of the first type, for fixed-size slot arrays
+    Facility(size_t typeId, int buildTime);
+    size_t getTypeId() const;
     const int getTimeLeft() const;
     FacilityStatus step();
+    void advance(int steps); // Same as calling step() `steps` times while the facility does not finish
     void setStatus(FacilityStatus status);
     const FacilityStatus &getStatus() const;
-    const string toString() const;
+    const string toString(const FacilityType &type) const;
 
 private:
-    const string settlementName;
-    FacilityStatus status;
+    uint32_t typeId;
     int timeLeft;
-};
\ No newline at end of file
+    FacilityStatus status;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BalancedDecisionCache.h"
+#include "Facility.h"
+using std::string;
+using std::vector;
+
+// The facility types a plan can choose from, in the order they were added.
+// Besides the full list it keeps the positions of each category and a name
+// index, both updated as facilities are added, so category based policies can
+// cycle through a short list instead of scanning the whole catalog. The scores
+// are also kept as contiguous columns for the balanced selection kernel.
+// Copies share the balanced decision cache until either one adds a facility.
+class FacilityCatalog
+{
+public:
+    static const size_t CategoryCount = 3;
+
+    FacilityCatalog();
+    bool add(const FacilityType &facility); // False if the name is taken
+    bool contains(const string &name) const;
+    size_t indexOf(const string &name) const; // Throws if the name is unknown
+    size_t size() const;
+    bool empty() const;
+    const FacilityType &operator[](size_t index) const;
+    const vector<FacilityType> &getFacilities() const;
+    const vector<size_t> &getCategory(FacilityCategory category) const; // Positions in add order
+    const vector<int> &getLifeQualityScores() const;
+    const vector<int> &getEconomyScores() const;
+    const vector<int> &getEnvironmentScores() const;
+    BalancedDecisionCache &getBalancedDecisions() const; // Thread-safe, valid for the current facilities only
+
+private:
+    vector<FacilityType> facilities;
+    vector<size_t> categories[CategoryCount];
+    vector<int> lifeQualityScores;
+    vector<int> economyScores;
+    vector<int> environmentScores;
+    std::unordered_map<string, size_t> indexesByName;
+    std::shared_ptr<BalancedDecisionCache> balancedDecisions;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+using std::string;
+
+class SnapshotWriter;
+
+// Write-ahead journal of the commands a simulation accepted, next to an
+// optional checkpoint file (<path>.checkpoint) holding the state at some
+// sequence number.
+// A record is the line "<sequence> <command>" and is written before the
+// command runs, so a killed process loses nothing. fsync is batched: it runs
+// once GroupSize records or GroupMilliseconds have gone by since the last one,
+// and on checkpoint and destruction, so a power loss loses one group at most.
+// A checkpoint is synced and renamed into place before the journal is
+// emptied, records it already covers are skipped on replay.
+class Journal
+{
+public:
+    static const size_t GroupSize = 256;
+    static const int GroupMilliseconds = 10; // Checked when a record is appended
+
+    struct Stats
+    {
+        uint64_t records; // Appended by this process
+        uint64_t syncs;
+        uint64_t checkpoints;
+    };
+
+    Journal(const string &path); // Opens or creates the journal, throws if it cannot
+    ~Journal();
+    Journal(const Journal &other) = delete;
+    Journal &operator=(const Journal &other) = delete;
+
+    const string &getCheckpointPath() const;
+    // Calls visit for every record from sequence `from` on, in order. A torn
+    // last record from a crash is cut off. Throws if a record is missing.
+    // Returns how many records were visited; appends continue after the last.
+    uint64_t replay(uint64_t from, const std::function<void(const string &command)> &visit);
+    void append(const string &command);
+    void sync();
+    void checkpoint(const SnapshotWriter &state); // Durably replaces the checkpoint file, then empties the journal
+    void discard();                        // Removes the checkpoint and empties the journal
+    uint64_t getNextSequence() const;
+    Stats getStats() const;
+
+private:
+    string path;
+    string checkpointPath;
+    int descriptor;
+    uint64_t nextSequence;
+    size_t unsynced; // Records written since the last fsync
+    std::chrono::steady_clock::time_point lastSync;
+    string record; // Scratch for append(), kept to reuse its memory
+    Stats stats;
+
+    void empty();
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+// Histogram of latencies in the style of HdrHistogram. Values below
+// 2^SubBucketBits are counted exactly. Every larger power of two is split in
+// 2^(SubBucketBits - 1) equal buckets, so a percentile is within 1/32 of the
+// recorded value whatever its magnitude. Recording is a few shifts and an
+// increment into a fixed table, nothing is allocated after construction.
+class LatencyHistogram
+{
+public:
+    static const int SubBucketBits = 6;
+    static const int MaxValueBits = 44; // Larger values count as 2^44 - 1, over four hours in nanoseconds
+
+    LatencyHistogram();
+    void record(uint64_t value);
+    void reset();
+    uint64_t getCount() const;
+    uint64_t getMin() const; // 0 when empty
+    uint64_t getMax() const;
+    double getMean() const;
+    // Highest value in the bucket holding the given percentile (0-100), at most the maximum
+    uint64_t getValueAtPercentile(double percentile) const;
+
+private:
+    vector<uint64_t> counts; // By bucket
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t highestValueIn(size_t bucket);
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Size-class pool for the small objects the simulation creates by the million
+// (facilities, settlements, actions and their shared_ptr control blocks).
+// Every thread carves objects out of 64 KiB blocks and keeps freed ones on its
+// own free lists, so allocating and freeing is a pointer swap with no locking
+// and no malloc. Free lists of an exiting thread are handed to the others.
+// Blocks are kept for reuse until the process exits.
+// Setting SPL_POOL=0 in the environment sends every request to the global
+// heap instead, for comparisons and for leak or address sanitizers.
+class ObjectPool
+{
+public:
+    static const size_t MaxPooledSize = 256; // Larger requests go to the global heap
+
+    struct Stats
+    {
+        size_t blocks;
+        size_t reservedBytes;
+        uint64_t allocations; // Requests since the process started, pooled or not
+    };
+
+    static void *allocate(size_t size);
+    static void deallocate(void *object, size_t size);
+    static bool isEnabled();
+    static Stats getStats();
+};
+
+// Base class that routes operator new and delete of a class hierarchy through
+// the pool. The sized delete gets the size of the dynamic type as long as the
+// hierarchy has a virtual destructor.
+class PooledObject
+{
+public:
+    static void *operator new(size_t size)
+    {
+        return ObjectPool::allocate(size);
+    }
+
+    static void operator delete(void *object, size_t size)
+    {
+        ObjectPool::deallocate(object, size);
+    }
+
+protected:
+    ~PooledObject() = default; // Never deleted through this base
+};
+
+// Standard allocator over the pool, used for shared_ptr control blocks
+template <typename T>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+
+    PoolAllocator() {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(ObjectPool::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T *object, size_t count)
+    {
+        ObjectPool::deallocate(object, count * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+    return false;
+}
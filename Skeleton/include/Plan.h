@@ -1,53 +1,102 @@
 #pragma once
+#include <climits>
+#include <string>
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
 using std::vector;
 
-enum class PlanStatus
+class SnapshotWriter;
+class SnapshotReader;
+
+enum class PlanStatus : uint8_t
 {
     AVALIABLE,
     BUSY,
 };
 
+// Consecutive operational facilities of one type
+struct FacilityRun
+{
+    uint32_t typeId;
+    uint32_t count;
+};
+
+// What a run of steps did, added up by whoever steps the plans. Every
+// facility started is one selection by the plan's policy. A stalled
+// selection is an available plan whose policy had nothing to select.
+struct StepCounts
+{
+    uint64_t facilitiesStarted;
+    uint64_t facilitiesCompleted;
+    uint64_t stalledSelections;
+    int firstStalledPlan; // Lowest plan id among the stalled ones
+};
+
 class Plan
 {
 public:
-    Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
-    ~Plan();                                                                                            // Destructor
-    Plan(const Plan &other);                                                                            // Copy constructor
-    Plan(const Plan &other, const Settlement &settlement, const vector<FacilityType> &facilityOptions); // Copy constructor 2
-    Plan &operator=(const Plan &other);                                                                 // Copy assignment operator
-    Plan(Plan &&other) noexcept;                                                                        // Move constructor
-    Plan &operator=(Plan &&other) noexcept;                                                             // Move assignment operator
+    static const size_t MaxUnderConstruction = 3; // Limit of a metropolis, see SettlementType
+    static const int NoEvent = INT_MAX;
+
+    Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy);
+    Plan(const Plan &other, SelectionPolicy *selectionPolicy); // A copy that goes on under another policy
+    ~Plan();                                // Destructor
+    Plan(const Plan &other);                // Copy constructor
+    Plan &operator=(const Plan &other);     // Copy assignment operator
+    Plan(Plan &&other) noexcept;            // Move constructor
+    Plan &operator=(Plan &&other) noexcept; // Move assignment operator
 
     const int getlifeQualityScore() const;
     const int getEconomyScore() const;
     const int getEnvironmentScore() const;
-    void setSelectionPolicy(SelectionPolicy *selectionPolicy);
     SelectionPolicy *getSelectionPolicy() const;
-    void step();
-    void printStatus();
-    const vector<Facility *> &getFacilities() const;
-    void addFacility(Facility *facility);
+    PolicyKind getPolicyKind() const;
+    void step(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented = false); // For Tracer and Profiler
+    // step() for a plan whose policy is a Policy, which is then called
+    // without the vtable. Instantiated for the four policies.
+    template <typename Policy>
+    void step(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented = false);
+    int stepsUntilEvent() const; // Steps until the next step() that selects or completes a facility, NoEvent if none will
+    void fastForward(int steps); // Skips steps that would neither select nor complete anything
+    void printStatus(const FacilityCatalog &facilityOptions, bool summary = false) const; // A summary lists each operational type once with its count
+    const vector<FacilityRun> &getOperationalRuns() const; // In completion order
     const string toString() const;
     const int getId() const;
 
     const Settlement getSettlement() const;
-    void moveFacilityToUnderConstruction(Facility *facility);
-    void moveFacilityToOperational(Facility *facility);
+
+    // Snapshot support: facilities are written as positions in the facility catalog
+    void saveState(SnapshotWriter &out) const;
+    void loadState(SnapshotReader &in, const FacilityCatalog &facilityOptions);
 
 private:
+    // Everything a step reads comes first and fills one 64-byte cache line,
+    // facilities under construction included, so stepping a chunk of plans
+    // streams through memory. The settlement and the operational facilities
+    // are only touched when a facility completes or the plan is printed.
+    // Operational facilities are kept as runs, so a plan that keeps building
+    // the same types grows by a counter instead of an object per facility.
     int plan_id;
-    const Settlement &settlement;
-    SelectionPolicy *selectionPolicy; // What happens if we change this to a reference?
     PlanStatus status;
-    vector<Facility *> facilities;
-    vector<Facility *> underConstruction;
-    const vector<FacilityType> &facilityOptions;
+    PolicyKind policyKind; // Kind of selectionPolicy, so dispatch needs no load through it
+    unsigned char constructionLimit; // Facilities the settlement can build at once
+    unsigned char underConstruction; // Used slots of building, in start order
     int life_quality_score, economy_score, environment_score;
+    Facility building[MaxUnderConstruction];
+    SelectionPolicy *selectionPolicy; // What happens if we change this to a reference?
+    const Settlement &settlement; // Settlements are never changed, so snapshots share them
+    vector<FacilityRun> operationalRuns;
+
+    // Only through PlanChunk::setSelectionPolicy, which moves the plan to the group of its new policy
+    friend class PlanChunk;
+    void setSelectionPolicy(SelectionPolicy *selectionPolicy);
 
+    size_t selectInstrumented(const FacilityCatalog &facilityOptions);
+    void completeFacility(size_t typeId, const FacilityType &type);
+    void addOperational(uint32_t typeId, uint32_t count);
     void copyFrom(const Plan &other);
     void moveFrom(Plan &&other) noexcept;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "FacilityCatalog.h"
+#include "Plan.h"
+using std::vector;
+
+// A run of consecutive plans, stored contiguously with their facilities under
+// construction inline, so a step walks the chunk front to back. Chunks share
+// nothing, so the simulation steps them in parallel and shares them
+// copy-on-write between backups.
+// Plans are also grouped by the kind of their policy, and a step runs each
+// group through Plan::step<Policy>, so selections are direct calls and the
+// same code runs back to back. The groups only decide the order plans are
+// stepped in, which never changes a result: plans do not read each other.
+class PlanChunk
+{
+public:
+    static const int NoEvent = Plan::NoEvent;
+
+    PlanChunk();
+    void reserve(size_t plans);
+    Plan &addPlan(int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy);
+    void setSelectionPolicy(size_t index, SelectionPolicy *selectionPolicy); // Moves the plan to the group of its new policy
+    size_t size() const;
+    Plan &operator[](size_t index);
+    const Plan &operator[](size_t index) const;
+
+    void step(const FacilityCatalog &facilityOptions, StepCounts &counts);
+    int stepsUntilEvent() const; // Steps until the next step() that selects or completes a facility, NoEvent if none will
+    void fastForward(int steps); // Skips steps that would neither select nor complete anything
+
+private:
+    vector<Plan> plans;
+    vector<uint32_t> groups[PolicyKindCount]; // Positions in plans by policy kind, ascending
+
+    template <typename Policy>
+    void stepGroup(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented);
+};
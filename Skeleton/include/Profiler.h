@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+using std::string;
+
+enum class ProfilePhase
+{
+    CONFIG_LOAD,
+    STEP,
+    SELECTION, // Part of STEP, counted on the threads that select
+    BACKUP_RESTORE,
+    OUTPUT,
+    NONE,
+};
+
+// Optional hardware counters per phase, read with perf_event_open: cycles,
+// instructions, cache misses and branch misses in user space.
+// Every thread that works for a phase opens a counter group of its own (the
+// pool's workers attach when they wake up), and a phase adds up the change
+// of all groups between its start and end. Selections are too short to
+// read, so they toggle a second, normally disabled group instead.
+// When the counters cannot be opened (no PMU in a container or VM,
+// perf_event_paranoid too high) phases still count runs and time, and the
+// report says why. Groups are only read between commands, while no other
+// thread is working. Off by default, SPL_PROFILE=1 starts it with the process.
+class Profiler
+{
+public:
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    static void start(); // Throws if profiling is on already
+    static void stop();  // Keeps the totals for print(), throws if profiling is off
+    static void reset();
+    static void attachThread(); // Opens the calling thread's counters if profiling is on
+    static void print(std::ostream &out);
+
+private:
+    friend class ProfiledPhase;
+    static std::atomic<bool> enabled;
+};
+
+// Adds what happens from construction to destruction to a phase while
+// profiling is on. While it is off it costs one relaxed load.
+class ProfiledPhase
+{
+public:
+    static const int EventCount = 4;
+
+    explicit ProfiledPhase(ProfilePhase phase);
+    ~ProfiledPhase();
+    ProfiledPhase(const ProfiledPhase &other) = delete;
+    ProfiledPhase &operator=(const ProfiledPhase &other) = delete;
+
+private:
+    ProfilePhase phase; // NONE when not profiling
+    uint64_t session;
+    int64_t begin;
+    uint64_t counters[EventCount];
+};
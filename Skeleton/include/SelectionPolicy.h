@@ -1,37 +1,72 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "ObjectPool.h"
 using std::vector;
 
-class SelectionPolicy
+class SnapshotWriter;
+class SnapshotReader;
+
+// The policies are a closed set. Each one names its kind, so code that steps
+// many plans can group them by kind and call the final class directly instead
+// of going through the vtable for every selection.
+enum class PolicyKind : uint8_t
+{
+    NAIVE,
+    BALANCED,
+    ECONOMY,
+    SUSTAINABILITY,
+};
+
+static const size_t PolicyKindCount = 4;
+
+class SelectionPolicy : public PooledObject
 {
 public:
-    virtual const FacilityType &selectFacility(const vector<FacilityType> &facilitiesOptions) = 0;
+    virtual PolicyKind kind() const = 0;
+    virtual size_t selectFacility(const FacilityCatalog &facilitiesOptions) = 0; // Position of the choice in the catalog
+    virtual bool canSelect(const FacilityCatalog &facilitiesOptions) const = 0; // False if selectFacility would throw
     virtual const string toString() const = 0;
     virtual SelectionPolicy *clone() const = 0;
+    virtual void saveState(SnapshotWriter &out) const = 0;
+    virtual void loadState(SnapshotReader &in) = 0;
     virtual ~SelectionPolicy() = default;
 };
 
-class NaiveSelection : public SelectionPolicy
+class NaiveSelection final : public SelectionPolicy
 {
 public:
+    static const PolicyKind Kind = PolicyKind::NAIVE;
+
     NaiveSelection();
-    const FacilityType &selectFacility(const vector<FacilityType> &facilitiesOptions) override;
+    PolicyKind kind() const override;
+    size_t selectFacility(const FacilityCatalog &facilitiesOptions) override;
+    bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
     const string toString() const override;
     NaiveSelection *clone() const override;
+    void saveState(SnapshotWriter &out) const override;
+    void loadState(SnapshotReader &in) override;
     ~NaiveSelection() override = default;
 
 private:
     int lastSelectedIndex;
 };
 
-class BalancedSelection : public SelectionPolicy
+class BalancedSelection final : public SelectionPolicy
 {
 public:
+    static const PolicyKind Kind = PolicyKind::BALANCED;
+
     BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore);
-    const FacilityType &selectFacility(const vector<FacilityType> &facilitiesOptions) override;
+    PolicyKind kind() const override;
+    size_t selectFacility(const FacilityCatalog &facilitiesOptions) override;
+    bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
     const string toString() const override;
     BalancedSelection *clone() const override;
+    void saveState(SnapshotWriter &out) const override;
+    void loadState(SnapshotReader &in) override;
     ~BalancedSelection() override = default;
 
 private:
@@ -40,28 +75,40 @@ private:
     int EnvironmentScore;
 };
 
-class EconomySelection : public SelectionPolicy
+class EconomySelection final : public SelectionPolicy
 {
 public:
+    static const PolicyKind Kind = PolicyKind::ECONOMY;
+
     EconomySelection();
-    const FacilityType &selectFacility(const vector<FacilityType> &facilitiesOptions) override;
+    PolicyKind kind() const override;
+    size_t selectFacility(const FacilityCatalog &facilitiesOptions) override;
+    bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
     const string toString() const override;
     EconomySelection *clone() const override;
+    void saveState(SnapshotWriter &out) const override;
+    void loadState(SnapshotReader &in) override;
     ~EconomySelection() override = default;
 
 private:
-    int lastSelectedIndex;
+    int lastSelectedIndex; // Position in the catalog's economy list
 };
 
-class SustainabilitySelection : public SelectionPolicy
+class SustainabilitySelection final : public SelectionPolicy
 {
 public:
+    static const PolicyKind Kind = PolicyKind::SUSTAINABILITY;
+
     SustainabilitySelection();
-    const FacilityType &selectFacility(const vector<FacilityType> &facilitiesOptions) override;
+    PolicyKind kind() const override;
+    size_t selectFacility(const FacilityCatalog &facilitiesOptions) override;
+    bool canSelect(const FacilityCatalog &facilitiesOptions) const override;
     const string toString() const override;
     SustainabilitySelection *clone() const override;
+    void saveState(SnapshotWriter &out) const override;
+    void loadState(SnapshotReader &in) override;
     ~SustainabilitySelection() override = default;
 
 private:
-    int lastSelectedIndex;
+    int lastSelectedIndex; // Position in the catalog's environment list
 };
\ No newline at end of file
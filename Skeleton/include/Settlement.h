@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "ObjectPool.h"
 using std::string;
 using std::vector;
 
@@ -13,7 +14,7 @@ enum class SettlementType : unsigned int
     METROPOLIS = 3, // 3
 };
 
-class Settlement
+class Settlement : public PooledObject
 {
 public:
     Settlement(const string &name, SettlementType type);
@@ -1,14 +1,45 @@
 #pragma once
+#include <istream>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "ActionLog.h"
+#include "Auxiliary.h"
+#include "ConfigLoader.h"
+#include "CowPtr.h"
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "Journal.h"
 #include "Plan.h"
+#include "PlanChunk.h"
 #include "Settlement.h"
+#include "SimulationStats.h"
+#include "WorkStealingPool.h"
 using std::string;
 using std::vector;
 
 class BaseAction;
 class SelectionPolicy;
+class SnapshotWriter;
+class SnapshotReader;
+
+// Scores summed over all plans
+struct ScoreTotals
+{
+    long long lifeQualityScore;
+    long long economyScore;
+    long long environmentScore;
+};
+
+// A plan's scores after some more steps under one policy, see Simulation::advise
+struct PolicyProjection
+{
+    string policy;
+    bool current;    // The plan's own policy, stepped with its state
+    bool selectable; // False if the policy has nothing to select, the scores are then the plan's own
+    ScoreTotals scores;
+};
 
 class Simulation
 {
@@ -21,28 +52,85 @@ public:
     Simulation &operator=(Simulation &&other) noexcept; // Move assignment operator
 
     void start();
+    long runScript(std::istream &input); // Runs commands without prompts until close or end of input, returns how many
     void processCommand(const std::string &line);
-    void executeAction(BaseAction *action);
+    void executeAction(BaseAction *action, CommandType type); // Runs, times and logs the action
     void addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy);
-    void addAction(BaseAction *action);
+    void addAction(BaseAction *action); // Logs the action and deletes it
     bool addSettlement(Settlement *settlement);
-    bool addFacility(FacilityType facility);
+    bool addFacility(const FacilityType &facility);
     bool isSettlementExists(const string &settlementName);
     Settlement &getSettlement(const string &settlementName);
     Plan &getPlan(const int planID);
+    const Plan &getPlan(const int planID) const;
+    void setPlanPolicy(const int planID, SelectionPolicy *selectionPolicy); // Takes the policy, throws if the plan does not exist
+    void printPlanStatus(const int planID, bool summary = false) const; // A summary counts operational facilities by type
+    const vector<int> &getPlanIds(const string &settlementName) const; // Plans built in a settlement, in creation order
+    size_t getPlanCount() const;
+    ScoreTotals getScoreTotals() const;
+    void setSelectionPolicies(const string &policy); // Gives every plan its own instance of the policy, throws if unknown
+    void useFacilitiesOf(const Simulation &other);   // Shares other's facility catalog, only before the first step
+    // Steps copies of one plan under each policy, as changePolicy would set
+    // it, without touching the simulation. Throws if the plan does not exist.
+    vector<PolicyProjection> advise(int planId, int numOfSteps);
     void step();
+    void step(int numThreads); // Steps the plans on numThreads threads, same result as step()
+    void fastForward(int numOfSteps, int numThreads); // Same as numOfSteps calls to step(), skipping idle steps
+    void setThreads(int numThreads);
+    int getThreads() const;
+    const ConfigLoadStats &getConfigLoadStats() const;
+    const FacilityCatalog &getFacilityCatalog() const;
+    BalancedDecisionCache::Stats getBalancedDecisionStats() const;
+    const SimulationStats &getStats() const;
+    void resetStats();
     void close();
     void open();
-    vector<BaseAction *> getActionsLog();
+    const ActionLog &getActionsLog() const;
+    void save(const string &path) const; // Writes a binary snapshot, see Snapshot.h
+    void load(const string &path);       // Replaces the state with a snapshot from save()
+    // Recovers the checkpoint and journal at path without printing, then
+    // journals every accepted command before it runs and checkpoints every
+    // checkpointEvery commands (0 for never) and after `load`. A clean
+    // `close` discards both. Returns how many commands were replayed.
+    uint64_t openJournal(const string &path, size_t checkpointEvery);
+    void checkpoint(); // Saves the state and the backups, then empties the journal
+    const Journal *getJournal() const; // Null without a journal
+    bool isReplaying() const;          // Output is skipped while the journal is replayed
 
 private:
+    static const size_t PlanChunkSize = 256;
+
+    // All state lives behind copy-on-write pointers, so copying a simulation (backup)
+    // is O(1) and later changes only copy the parts they touch.
     bool isRunning;
     int planCounter; // For assigning unique plan IDs
-    vector<BaseAction *> actionsLog;
-    vector<Plan> plans;
-    vector<Settlement *> settlements;
-    vector<FacilityType> facilitiesOptions;
+    CowPtr<ActionLog> actionsLog;
+    CowPtr<vector<CowPtr<PlanChunk>>> plans; // Plans in creation order, PlanChunkSize per chunk
+    CowPtr<vector<std::shared_ptr<Settlement>>> settlements;
+    CowPtr<FacilityCatalog> facilitiesOptions;
+    // Lookup indexes
+    CowPtr<std::unordered_map<string, Settlement *>> settlementsByName;
+    CowPtr<std::unordered_map<int, size_t>> plansById;           // Plan ID -> position in plans
+    CowPtr<std::unordered_map<string, vector<int>>> planIdsBySettlement;
+    int numThreads;                         // Default thread count for step, 1 means serial
+    std::unique_ptr<WorkStealingPool> pool; // Created on first parallel step, never copied
+    ArgumentList commandArguments;          // Reused by processCommand to avoid allocations
+    ConfigLoadStats configLoadStats;
+    std::unique_ptr<Journal> journal; // Belongs to the running simulation, never copied
+    bool replaying;
+    size_t checkpointEvery;
+    size_t commandsSinceCheckpoint;
+    SimulationStats stats; // Describes this process, so restore and load keep it
+    vector<StepCounts> chunkCounts; // What each chunk did in the running step, kept to reuse its memory
 
+    const Plan &planAt(size_t index) const;
+    Plan &planAt(size_t index); // Only safe from several threads after detachPlans()
+    void detachPlans();         // Makes every plan chunk private to this simulation
+    WorkStealingPool &getPool(int numThreads);
+    void writeState(SnapshotWriter &out) const;
+    void readState(SnapshotReader &in); // Leaves this simulation untouched if it throws
+    uint64_t loadCheckpoint(const string &path); // Returns the next journal sequence
+    void clear();
     void copyFrom(const Simulation &other);
     void moveFrom(Simulation &&other) noexcept;
 };
\ No newline at end of file
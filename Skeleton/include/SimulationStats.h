@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "Auxiliary.h"
+#include "LatencyHistogram.h"
+#include "Plan.h"
+using std::vector;
+
+// Latency of every command by type, and counters of what the steps and the
+// object pool did since the last reset. Kept by the running simulation only,
+// backups and snapshots do not carry it.
+class SimulationStats
+{
+public:
+    SimulationStats();
+    void recordCommand(CommandType type, uint64_t nanoseconds);
+    void addSteps(const StepCounts &counts);
+    void reset();
+    const LatencyHistogram &getLatency(CommandType type) const;
+    const StepCounts &getStepCounts() const;
+    uint64_t getAllocations() const; // Object pool requests since the last reset
+    void print(std::ostream &out) const;
+
+private:
+    vector<LatencyHistogram> latencies; // Indexed by CommandType
+    StepCounts steps;
+    uint64_t allocationsAtReset;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using std::string;
+
+// Binary snapshot format used by `save` and `load`.
+// A file starts with SnapshotMagic and a format version, followed by varint
+// encoded fields. Bump SnapshotVersion whenever the layout changes.
+const char SnapshotMagic[8] = {'S', 'P', 'L', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SnapshotVersion = 3;
+
+class SnapshotWriter
+{
+public:
+    SnapshotWriter();
+    void writeUnsigned(uint64_t value); // LEB128 varint
+    void writeSigned(int64_t value);    // Zigzag varint
+    void writeString(const string &value);
+    void writeRaw(const char *data, size_t size);
+    const string &getBuffer() const;
+    size_t size() const;
+    void clear(); // Keeps the buffer's memory
+    void saveToFile(const string &path) const; // Durably replaces the file, throws if it cannot
+
+private:
+    string buffer;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(const char *data, size_t size);
+    uint64_t readUnsigned();
+    int64_t readSigned();
+    int readInt(); // Signed varint that must fit an int
+    string readString();
+    void readRaw(char *out, size_t size);
+    bool atEnd() const;
+
+private:
+    const char *current;
+    const char *end;
+};
+
+// A read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile(const string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    const char *data() const;
+    size_t size() const;
+
+private:
+    const char *address;
+    size_t length;
+};
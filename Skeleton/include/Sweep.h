@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Simulation.h"
+using std::string;
+using std::vector;
+
+// What-if runs over one base config. The grid file uses the config grammar:
+//   # policy <nve|bal|eco|env|config>...  every plan runs with this policy, config keeps its own (default: all four)
+//   # steps <number_of_steps>...           horizons to report, at least one
+//   # catalog <name> <config_path>         the facilities of that config replace the base ones
+//   # threads <count>                      runs at once (default: one per core)
+// Every catalog (the base one first) is combined with every policy, and each
+// combination is one Simulation stepped through the horizons in increasing
+// order. Runs are copies of one loaded simulation per catalog, so they share
+// the catalog read-only and copy plans only as they step them.
+class Sweep
+{
+public:
+    struct Result
+    {
+        string catalog;
+        string policy;
+        int steps;
+        size_t plans;
+        long long lifeQualityScore; // Sums over all plans
+        long long economyScore;
+        long long environmentScore;
+    };
+
+    Sweep(const string &configFilePath, const string &gridFilePath); // Throws on a bad grid or config
+    size_t getRunCount() const;
+    int getThreads() const;
+    // Runs every combination concurrently. Results come in grid order, a run
+    // that fails (a policy with nothing to select) is reported on stderr.
+    vector<Result> run();
+    static void printResults(std::ostream &out, const vector<Result> &results); // CSV with a header
+
+private:
+    struct Catalog
+    {
+        string name;
+        Simulation base;
+    };
+
+    vector<Catalog> catalogs;
+    vector<string> policies;
+    vector<int> horizons; // Increasing, no duplicates
+    int threads;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+using std::string;
+
+// Opt-in tracer of nested spans, written as Chrome trace-event JSON that
+// chrome://tracing and Perfetto open.
+// Every thread appends to a buffer of its own, registered the first time it
+// records in a session, so recording takes no lock. Buffers are only read by
+// stop(), which must not overlap spans still being recorded on other threads
+// (commands run one at a time and parallel steps join before they return).
+// While tracing is off a span costs one relaxed load and a branch.
+class Tracer
+{
+public:
+    // Spans a thread records past the limit are dropped and counted. The limit
+    // comes from SPL_TRACE_EVENTS, DefaultMaxEventsPerThread if unset.
+    static const size_t DefaultMaxEventsPerThread = 1 << 20;
+
+    struct Stats
+    {
+        uint64_t events;
+        uint64_t dropped;
+        size_t threads;
+    };
+
+    static bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    static void start();                  // Throws if tracing is on already
+    static Stats stop(const string &path); // Writes the spans and turns tracing off, throws if it was off or the file cannot be written
+    static uint64_t now();                // Nanoseconds since start()
+    static void record(const char *name, const char *category, uint64_t begin, uint64_t end);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+// Records the span from construction to destruction while tracing is on.
+// Names and categories must outlive the trace, string literals in practice.
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, const char *category)
+        : name(name), category(category), begin(Tracer::isEnabled() ? Tracer::now() : NotTraced) {}
+
+    ~TraceSpan()
+    {
+        if (begin != NotTraced && Tracer::isEnabled())
+        {
+            Tracer::record(name, category, begin, Tracer::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan &other) = delete;
+    TraceSpan &operator=(const TraceSpan &other) = delete;
+
+private:
+    static const uint64_t NotTraced = UINT64_MAX;
+
+    const char *name;
+    const char *category;
+    uint64_t begin;
+};
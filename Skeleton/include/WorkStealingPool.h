@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+using std::vector;
+
+// A fixed-size thread pool that runs index ranges with work stealing.
+// Every worker owns a deque of ranges: it pops from the back of its own deque
+// and steals from the front of the others when it runs dry, so uneven items
+// (a metropolis plan next to a village plan) still keep all threads busy.
+class WorkStealingPool
+{
+public:
+    WorkStealingPool(int numThreads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool &other) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &other) = delete;
+
+    int size() const;
+    // Runs body(i) for every i in [0, count) and returns when all are done.
+    // The calling thread takes part as worker 0. If some bodies throw, the
+    // exception of the lowest index is rethrown, as a serial loop would.
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+private:
+    struct WorkQueue
+    {
+        WorkQueue() : lock(), ranges() {}
+        std::mutex lock;
+        std::deque<std::pair<size_t, size_t>> ranges;
+    };
+
+    int numThreads;
+    vector<std::thread> workers;
+    vector<std::unique_ptr<WorkQueue>> queues;
+
+    std::mutex stateLock;
+    std::condition_variable wakeWorkers;
+    std::condition_variable workersDone;
+    const std::function<void(size_t)> *job;
+    unsigned long generation;
+    int activeWorkers;
+    bool stopping;
+
+    std::mutex errorLock;
+    std::exception_ptr error;
+    size_t errorIndex;
+
+    void workerLoop(int workerId);
+    void drain(int workerId);
+    bool takeRange(int workerId, std::pair<size_t, size_t> &range);
+    void runRange(const std::pair<size_t, size_t> &range);
+};
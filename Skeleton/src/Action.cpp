@@ -3,10 +3,15 @@
 #include "Settlement.h"
 #include "Facility.h"
 #include "Auxiliary.h"
+#include "Profiler.h"
+#include "Tracer.h"
 #include <iostream>
 #include <algorithm>
+#include <map>
 using namespace std;
-extern Simulation *backup;
+
+// Named backups. Copying a Simulation shares its state, so a backup costs O(1)
+std::map<string, Simulation> backups;
 
 // ActionStatus toString function
 std::string actionStatusToString(ActionStatus status)
@@ -64,20 +69,46 @@ const string &BaseAction::getErrorMsg() const
 }
 
 // SimulateStep implementation
-SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {}
+SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps), numOfThreads(0) {}
+
+SimulateStep::SimulateStep(const int numOfSteps, const int numOfThreads) : numOfSteps(numOfSteps), numOfThreads(numOfThreads) {}
 
 void SimulateStep::act(Simulation &simulation)
 {
-    for (int i = 0; i < numOfSteps; ++i)
+    if (numOfThreads < 0)
+    {
+        error("Thread count must be positive");
+        return;
+    }
+    int threads = numOfThreads > 0 ? numOfThreads : simulation.getThreads();
+    try
+    {
+        simulation.fastForward(numOfSteps, threads);
+    }
+    catch (const std::runtime_error &e)
     {
-        simulation.step();
+        // A plan had nothing to select, the others still stepped
+        error(e.what());
+        return;
     }
     complete();
 }
 
 const string SimulateStep::toString() const
 {
-    return "step " + std::to_string(numOfSteps) + " " + actionStatusToString(getStatus());
+    string threads = numOfThreads > 0 ? " --threads " + std::to_string(numOfThreads) : "";
+    return "step " + std::to_string(numOfSteps) + threads + " " + actionStatusToString(getStatus());
+}
+
+void SimulateStep::appendTo(ActionLog &log) const
+{
+    log.appendWord("step");
+    log.appendNumber(numOfSteps);
+    if (numOfThreads > 0)
+    {
+        log.appendWord("--threads");
+        log.appendNumber(numOfThreads);
+    }
 }
 
 SimulateStep *SimulateStep::clone() const
@@ -99,6 +130,7 @@ void AddPlan::act(Simulation &simulation)
     catch (std::runtime_error const&)
     {
         error("Cannot create this plan, Selection Policy doesn't exist");
+        return;
     }
     try
     {
@@ -107,6 +139,7 @@ void AddPlan::act(Simulation &simulation)
     }
     catch (std::runtime_error const&)
     {
+        delete policy;
         error("Cannot create this plan, Settlement doesn't exist");
     }
 }
@@ -116,6 +149,13 @@ const string AddPlan::toString() const
     return "plan " + settlementName + " " + selectionPolicy + " " + actionStatusToString(getStatus());
 }
 
+void AddPlan::appendTo(ActionLog &log) const
+{
+    log.appendWord("plan");
+    log.appendWord(settlementName);
+    log.appendWord(selectionPolicy);
+}
+
 AddPlan *AddPlan::clone() const
 {
     return new AddPlan(*this);
@@ -145,6 +185,13 @@ const string AddSettlement::toString() const
     // the settlement numbers correlate to the building limit and as such are 1 higher, so we reduce them by 1
 }
 
+void AddSettlement::appendTo(ActionLog &log) const
+{
+    log.appendWord("settlement");
+    log.appendWord(settlementName);
+    log.appendNumber(static_cast<unsigned int>(settlementType) - 1);
+}
+
 AddSettlement *AddSettlement::clone() const
 {
     return new AddSettlement(*this);
@@ -172,20 +219,30 @@ const string AddFacility::toString() const
     return "facility " + facilityName + " " + facilityCategoryToString(facilityCategory) + " " + std::to_string(price) + " " + std::to_string(lifeQualityScore) + " " + std::to_string(economyScore) + " " + std::to_string(environmentScore) + " " + actionStatusToString(getStatus());
 }
 
+void AddFacility::appendTo(ActionLog &log) const
+{
+    log.appendWord("facility");
+    log.appendWord(facilityName);
+    log.appendWord(facilityCategoryToString(facilityCategory));
+    log.appendNumber(price);
+    log.appendNumber(lifeQualityScore);
+    log.appendNumber(economyScore);
+    log.appendNumber(environmentScore);
+}
+
 AddFacility *AddFacility::clone() const
 {
     return new AddFacility(*this);
 }
 
 // PrintPlanStatus implementation
-PrintPlanStatus::PrintPlanStatus(int planId) : planId(planId) {}
+PrintPlanStatus::PrintPlanStatus(int planId, bool summary) : planId(planId), summary(summary) {}
 
 void PrintPlanStatus::act(Simulation &simulation)
 {
     try
     {
-        Plan &plan = simulation.getPlan(planId);
-        plan.printStatus();
+        simulation.printPlanStatus(planId, summary);
         complete();
     }
     catch (std::runtime_error const&)
@@ -196,7 +253,17 @@ void PrintPlanStatus::act(Simulation &simulation)
 
 const string PrintPlanStatus::toString() const
 {
-    return "planStatus " + std::to_string(planId) + " " + actionStatusToString(getStatus());
+    return "planStatus " + std::to_string(planId) + (summary ? " --summary " : " ") + actionStatusToString(getStatus());
+}
+
+void PrintPlanStatus::appendTo(ActionLog &log) const
+{
+    log.appendWord("planStatus");
+    log.appendNumber(planId);
+    if (summary)
+    {
+        log.appendWord("--summary");
+    }
 }
 
 PrintPlanStatus *PrintPlanStatus::clone() const
@@ -213,11 +280,11 @@ void ChangePlanPolicy::act(Simulation &simulation)
     // should error when the previous policy is the same as the new policy or if the planID doesn't exist
     try
     {
-        Plan &plan = simulation.getPlan(planId);
+        const Plan &plan = simulation.getPlan(planId);
         if (newPolicy != plan.getSelectionPolicy()->toString())
         {
             SelectionPolicy *policy = Auxiliary::createSelectionPolicy(newPolicy);
-            plan.setSelectionPolicy(policy);
+            simulation.setPlanPolicy(planId, policy);
             complete();
         }
         else
@@ -236,6 +303,13 @@ const string ChangePlanPolicy::toString() const
     return "changePolicy " + std::to_string(planId) + " " + newPolicy + " " + actionStatusToString(getStatus());
 }
 
+void ChangePlanPolicy::appendTo(ActionLog &log) const
+{
+    log.appendWord("changePolicy");
+    log.appendNumber(planId);
+    log.appendWord(newPolicy);
+}
+
 ChangePlanPolicy *ChangePlanPolicy::clone() const
 {
     return new ChangePlanPolicy(*this);
@@ -246,10 +320,9 @@ PrintActionsLog::PrintActionsLog() {}
 
 void PrintActionsLog::act(Simulation &simulation)
 {
-    const vector<BaseAction *> &actionsLog = simulation.getActionsLog();
-    for (const auto &action : actionsLog)
+    if (!simulation.isReplaying())
     {
-        cout << action->toString() << endl;
+        simulation.getActionsLog().print(cout);
     }
     complete();
 }
@@ -259,6 +332,11 @@ const string PrintActionsLog::toString() const
     return "log " + actionStatusToString(getStatus());
 }
 
+void PrintActionsLog::appendTo(ActionLog &log) const
+{
+    log.appendWord("log");
+}
+
 PrintActionsLog *PrintActionsLog::clone() const
 {
     return new PrintActionsLog(*this);
@@ -278,27 +356,47 @@ const string Close::toString() const
     return "close " + actionStatusToString(getStatus());
 }
 
+void Close::appendTo(ActionLog &log) const
+{
+    log.appendWord("close");
+}
+
 Close *Close::clone() const
 {
     return new Close(*this);
 }
 
 // BackupSimulation implementation
-BackupSimulation::BackupSimulation() {}
+BackupSimulation::BackupSimulation() : backupName() {}
+
+BackupSimulation::BackupSimulation(const string &backupName) : backupName(backupName) {}
 
 void BackupSimulation::act(Simulation &simulation)
 {
-    if (backup != nullptr)
+    auto found = backups.find(backupName);
+    if (found != backups.end())
+    {
+        found->second = simulation; // Use the assignment operator
+    }
+    else
     {
-        delete backup;
+        backups.emplace(backupName, simulation); // Use the copy constructor
     }
-    backup = new Simulation(simulation); // Use the copy constructor
     complete();
 }
 
 const string BackupSimulation::toString() const
 {
-    return "backup " + actionStatusToString(getStatus());
+    return "backup " + (backupName.empty() ? "" : backupName + " ") + actionStatusToString(getStatus());
+}
+
+void BackupSimulation::appendTo(ActionLog &log) const
+{
+    log.appendWord("backup");
+    if (!backupName.empty())
+    {
+        log.appendWord(backupName);
+    }
 }
 
 BackupSimulation *BackupSimulation::clone() const
@@ -307,13 +405,16 @@ BackupSimulation *BackupSimulation::clone() const
 }
 
 // RestoreSimulation implementation
-RestoreSimulation::RestoreSimulation() {}
+RestoreSimulation::RestoreSimulation() : backupName() {}
+
+RestoreSimulation::RestoreSimulation(const string &backupName) : backupName(backupName) {}
 
 void RestoreSimulation::act(Simulation &simulation)
 {
-    if (backup != nullptr)
+    auto found = backups.find(backupName);
+    if (found != backups.end())
     {
-        simulation = *backup; // Use the assignment operator
+        simulation = found->second; // Use the assignment operator
         complete();
     }
     else
@@ -324,10 +425,306 @@ void RestoreSimulation::act(Simulation &simulation)
 
 const string RestoreSimulation::toString() const
 {
-    return "restore " + actionStatusToString(getStatus());
+    return "restore " + (backupName.empty() ? "" : backupName + " ") + actionStatusToString(getStatus());
+}
+
+void RestoreSimulation::appendTo(ActionLog &log) const
+{
+    log.appendWord("restore");
+    if (!backupName.empty())
+    {
+        log.appendWord(backupName);
+    }
 }
 
 RestoreSimulation *RestoreSimulation::clone() const
 {
     return new RestoreSimulation(*this);
-}
\ No newline at end of file
+}
+
+// SaveSimulation implementation
+SaveSimulation::SaveSimulation(const string &filePath) : filePath(filePath) {}
+
+void SaveSimulation::act(Simulation &simulation)
+{
+    // The file was written when the command first ran and may have changed since
+    if (simulation.isReplaying())
+    {
+        complete();
+        return;
+    }
+    try
+    {
+        simulation.save(filePath);
+        complete();
+    }
+    catch (const std::exception &e)
+    {
+        error(e.what());
+    }
+}
+
+const string SaveSimulation::toString() const
+{
+    return "save " + filePath + " " + actionStatusToString(getStatus());
+}
+
+void SaveSimulation::appendTo(ActionLog &log) const
+{
+    log.appendWord("save");
+    log.appendWord(filePath);
+}
+
+SaveSimulation *SaveSimulation::clone() const
+{
+    return new SaveSimulation(*this);
+}
+
+// LoadSimulation implementation
+LoadSimulation::LoadSimulation(const string &filePath) : filePath(filePath) {}
+
+void LoadSimulation::act(Simulation &simulation)
+{
+    try
+    {
+        simulation.load(filePath);
+        complete();
+    }
+    catch (const std::exception &e)
+    {
+        error(e.what());
+    }
+}
+
+const string LoadSimulation::toString() const
+{
+    return "load " + filePath + " " + actionStatusToString(getStatus());
+}
+
+void LoadSimulation::appendTo(ActionLog &log) const
+{
+    log.appendWord("load");
+    log.appendWord(filePath);
+}
+
+LoadSimulation *LoadSimulation::clone() const
+{
+    return new LoadSimulation(*this);
+}
+
+// PrintStats implementation
+PrintStats::PrintStats(bool reset) : reset(reset) {}
+
+void PrintStats::act(Simulation &simulation)
+{
+    if (reset)
+    {
+        simulation.resetStats();
+    }
+    else if (!simulation.isReplaying())
+    {
+        simulation.getStats().print(cout);
+    }
+    complete();
+}
+
+const string PrintStats::toString() const
+{
+    return string(reset ? "stats reset " : "stats ") + actionStatusToString(getStatus());
+}
+
+void PrintStats::appendTo(ActionLog &log) const
+{
+    log.appendWord("stats");
+    if (reset)
+    {
+        log.appendWord("reset");
+    }
+}
+
+PrintStats *PrintStats::clone() const
+{
+    return new PrintStats(*this);
+}
+
+// Trace implementation
+Trace::Trace() : filePath() {}
+
+Trace::Trace(const string &filePath) : filePath(filePath) {}
+
+void Trace::act(Simulation &simulation)
+{
+    // A replayed trace would write a file the first run already wrote
+    if (simulation.isReplaying())
+    {
+        complete();
+        return;
+    }
+    try
+    {
+        if (filePath.empty())
+        {
+            Tracer::start();
+        }
+        else
+        {
+            Tracer::Stats stats = Tracer::stop(filePath);
+            cout << "Wrote " << stats.events << " trace events from " << stats.threads << " threads to " << filePath;
+            if (stats.dropped > 0)
+            {
+                cout << " (" << stats.dropped << " dropped)";
+            }
+            cout << endl;
+        }
+        complete();
+    }
+    catch (const std::runtime_error &e)
+    {
+        error(e.what());
+    }
+}
+
+const string Trace::toString() const
+{
+    return (filePath.empty() ? string("trace start ") : "trace stop " + filePath + " ") + actionStatusToString(getStatus());
+}
+
+void Trace::appendTo(ActionLog &log) const
+{
+    log.appendWord("trace");
+    if (filePath.empty())
+    {
+        log.appendWord("start");
+    }
+    else
+    {
+        log.appendWord("stop");
+        log.appendWord(filePath);
+    }
+}
+
+Trace *Trace::clone() const
+{
+    return new Trace(*this);
+}
+
+// Profile implementation
+Profile::Profile(Request request) : request(request) {}
+
+void Profile::act(Simulation &simulation)
+{
+    // Profiling belongs to the process, a replay neither starts nor reports it
+    if (simulation.isReplaying())
+    {
+        complete();
+        return;
+    }
+    try
+    {
+        switch (request)
+        {
+        case Request::PRINT:
+            Profiler::print(cout);
+            break;
+        case Request::START:
+            Profiler::start();
+            break;
+        case Request::STOP:
+            Profiler::stop();
+            break;
+        case Request::RESET:
+            Profiler::reset();
+            break;
+        }
+        complete();
+    }
+    catch (const std::runtime_error &e)
+    {
+        error(e.what());
+    }
+}
+
+const string Profile::toString() const
+{
+    const char *requests[] = {"profile ", "profile start ", "profile stop ", "profile reset "};
+    return requests[static_cast<int>(request)] + actionStatusToString(getStatus());
+}
+
+void Profile::appendTo(ActionLog &log) const
+{
+    const char *requests[] = {nullptr, "start", "stop", "reset"};
+    log.appendWord("profile");
+    if (request != Request::PRINT)
+    {
+        log.appendWord(requests[static_cast<int>(request)]);
+    }
+}
+
+Profile *Profile::clone() const
+{
+    return new Profile(*this);
+}
+
+// AdvisePolicy implementation
+AdvisePolicy::AdvisePolicy(const int planId, const int numOfSteps) : planId(planId), numOfSteps(numOfSteps) {}
+
+void AdvisePolicy::act(Simulation &simulation)
+{
+    // Nothing changes, so a replay has nothing to redo
+    if (simulation.isReplaying())
+    {
+        complete();
+        return;
+    }
+    vector<PolicyProjection> projections;
+    try
+    {
+        projections = simulation.advise(planId, numOfSteps);
+    }
+    catch (const std::runtime_error &)
+    {
+        error("Plan doesn't exist");
+        return;
+    }
+    cout << "PlanID: " << planId << '\n';
+    cout << "Steps: " << numOfSteps << '\n';
+    const PolicyProjection *best = nullptr;
+    for (const PolicyProjection &projection : projections)
+    {
+        cout << projection.policy << (projection.current ? " (current)" : "") << ": ";
+        if (!projection.selectable)
+        {
+            cout << "no facility to select\n";
+            continue;
+        }
+        cout << "LifeQualityScore " << projection.scores.lifeQualityScore << ", EconomyScore " << projection.scores.economyScore
+             << ", EnvironmentScore " << projection.scores.environmentScore << '\n';
+        long long total = projection.scores.lifeQualityScore + projection.scores.economyScore + projection.scores.environmentScore;
+        if (best == nullptr || total > best->scores.lifeQualityScore + best->scores.economyScore + best->scores.environmentScore)
+        {
+            best = &projection;
+        }
+    }
+    if (best != nullptr)
+    {
+        cout << "HighestTotal: " << best->policy << '\n';
+    }
+    complete();
+}
+
+const string AdvisePolicy::toString() const
+{
+    return "advise " + std::to_string(planId) + " " + std::to_string(numOfSteps) + " " + actionStatusToString(getStatus());
+}
+
+void AdvisePolicy::appendTo(ActionLog &log) const
+{
+    log.appendWord("advise");
+    log.appendNumber(planId);
+    log.appendNumber(numOfSteps);
+}
+
+AdvisePolicy *AdvisePolicy::clone() const
+{
+    return new AdvisePolicy(*this);
+}
@@ -0,0 +1,373 @@
+#include "ActionLog.h"
+#include "Action.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+// An unlinked temporary file that is only appended to. Writes go to explicit
+// offsets, so a failed append leaves the recorded length untouched.
+class ActionLog::SpillFile
+{
+public:
+    SpillFile() : descriptor(-1), length(0)
+    {
+        const char *directory = std::getenv("TMPDIR");
+        string path = string(directory != nullptr && *directory != '\0' ? directory : "/tmp") + "/spl-log-XXXXXX";
+        descriptor = mkstemp(&path[0]);
+        if (descriptor < 0)
+        {
+            throw std::runtime_error("Could not create the log spill file");
+        }
+        unlink(path.c_str());
+    }
+
+    ~SpillFile()
+    {
+        close(descriptor);
+    }
+
+    SpillFile(const SpillFile &other) = delete;
+    SpillFile &operator=(const SpillFile &other) = delete;
+
+    uint64_t size() const
+    {
+        return length;
+    }
+
+    void append(const char *data, size_t size)
+    {
+        size_t written = 0;
+        while (written < size)
+        {
+            ssize_t result = pwrite(descriptor, data + written, size - written, static_cast<off_t>(length + written));
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                throw std::runtime_error("Could not write the log spill file");
+            }
+            written += static_cast<size_t>(result);
+        }
+        length += size;
+    }
+
+    void read(uint64_t offset, char *out, size_t size) const
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t result = pread(descriptor, out + done, size - done, static_cast<off_t>(offset + done));
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                throw std::runtime_error("Could not read the log spill file");
+            }
+            done += static_cast<size_t>(result);
+        }
+    }
+
+private:
+    int descriptor;
+    uint64_t length;
+};
+
+// The interned words, in an open-addressing table hashed over the raw
+// characters, so looking a word up builds no string. Ids are positions in
+// words and never change, which is what lets copies of a log share the table.
+class ActionLog::WordTable
+{
+public:
+    WordTable() : words(), slots(InitialSlots, 0) {}
+
+    uint32_t intern(const char *text, size_t length)
+    {
+        const uint32_t *table = slots.data();
+        size_t mask = slots.size() - 1;
+        for (size_t slot = hash(text, length) & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t entry = table[slot];
+            if (entry == 0)
+            {
+                uint32_t id = static_cast<uint32_t>(words.size());
+                words.emplace_back(text, length);
+                slots[slot] = id + 1;
+                if (words.size() * 2 > slots.size())
+                {
+                    grow();
+                }
+                return id;
+            }
+            const string &word = words[entry - 1];
+            if (word.size() == length && std::memcmp(word.data(), text, length) == 0)
+            {
+                return entry - 1;
+            }
+        }
+    }
+
+    const string &operator[](size_t id) const
+    {
+        return words[id];
+    }
+
+private:
+    static const size_t InitialSlots = 1024;
+
+    vector<string> words;
+    vector<uint32_t> slots; // Word id + 1, 0 when empty. A power of two, at most half full
+
+    static size_t hash(const char *text, size_t length)
+    {
+        uint64_t value = 14695981039346656037ULL; // FNV-1a
+        for (size_t i = 0; i < length; ++i)
+        {
+            value = (value ^ static_cast<unsigned char>(text[i])) * 1099511628211ULL;
+        }
+        return static_cast<size_t>(value ^ (value >> 32));
+    }
+
+    void grow()
+    {
+        vector<uint32_t> larger(slots.size() * 2, 0);
+        size_t mask = larger.size() - 1;
+        for (size_t id = 0; id < words.size(); ++id)
+        {
+            size_t slot = hash(words[id].data(), words[id].size()) & mask;
+            while (larger[slot] != 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            larger[slot] = static_cast<uint32_t>(id + 1);
+        }
+        slots.swap(larger);
+    }
+};
+
+static size_t spillThresholdSetting()
+{
+    static const size_t threshold = []
+    {
+        const char *setting = std::getenv("SPL_LOG_SPILL");
+        char *end = nullptr;
+        unsigned long long value = setting != nullptr ? std::strtoull(setting, &end, 10) : 0;
+        return setting != nullptr && *setting != '\0' && *end == '\0' ? static_cast<size_t>(value) : ActionLog::DefaultSpillThreshold;
+    }();
+    return threshold;
+}
+
+// Numbers are stored inline when they read back the same, so "007" is a word
+static bool isPlainNumber(const char *text, size_t length)
+{
+    if (length == 0 || length > 18 || (text[0] == '0' && length > 1))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (text[i] < '0' || text[i] > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+ActionLog::ActionLog() : ActionLog(spillThresholdSetting()) {}
+
+ActionLog::ActionLog(size_t spillThreshold)
+    : spillThreshold(spillThreshold), count(0), buffer(std::make_shared<SnapshotWriter>()), bufferedBytes(0), words(std::make_shared<WordTable>()), spill(), segments(), spilledBytes(0) {}
+
+void ActionLog::beginEntry()
+{
+    if (buffer->size() != bufferedBytes)
+    {
+        // A copy of this log appended since they parted, go on in a buffer of our own
+        std::shared_ptr<SnapshotWriter> own = std::make_shared<SnapshotWriter>();
+        own->writeRaw(buffer->getBuffer().data(), bufferedBytes);
+        buffer = own;
+    }
+}
+
+void ActionLog::appendWord(const char *word)
+{
+    encodeWord(word, std::strlen(word));
+}
+
+void ActionLog::appendWord(const string &word)
+{
+    encodeWord(word.data(), word.size());
+}
+
+void ActionLog::appendNumber(long long value)
+{
+    if (value < 0)
+    {
+        // Rare enough to be stored as a word
+        char text[24];
+        int length = std::snprintf(text, sizeof(text), "%lld", value);
+        encodeWord(text, static_cast<size_t>(length));
+        return;
+    }
+    buffer->writeUnsigned(static_cast<uint64_t>(value) << 2 | NumberField);
+}
+
+void ActionLog::endEntry(ActionStatus status)
+{
+    buffer->writeUnsigned(status == ActionStatus::ERROR ? ErrorEnd : CompletedEnd);
+    bufferedBytes = buffer->size();
+    ++count;
+    if (bufferedBytes >= spillThreshold)
+    {
+        spillBuffer();
+    }
+}
+
+void ActionLog::append(const string &command, ActionStatus status)
+{
+    beginEntry();
+    const char *text = command.data();
+    size_t length = command.size();
+    size_t begin = 0;
+    for (size_t i = 0; i <= length; ++i)
+    {
+        if (i == length || text[i] == ' ')
+        {
+            if (isPlainNumber(text + begin, i - begin))
+            {
+                appendNumber(std::strtoll(text + begin, nullptr, 10));
+            }
+            else
+            {
+                encodeWord(text + begin, i - begin);
+            }
+            begin = i + 1;
+        }
+    }
+    endEntry(status);
+}
+
+size_t ActionLog::size() const
+{
+    return count;
+}
+
+size_t ActionLog::getBufferedBytes() const
+{
+    return bufferedBytes;
+}
+
+uint64_t ActionLog::getSpilledBytes() const
+{
+    return spilledBytes;
+}
+
+void ActionLog::forEach(const std::function<void(const string &command, ActionStatus status)> &visit) const
+{
+    string segment;
+    uint64_t offset = 0;
+    for (uint64_t bytes : segments)
+    {
+        segment.resize(static_cast<size_t>(bytes));
+        spill->read(offset, &segment[0], segment.size());
+        decodeEntries(segment.data(), segment.size(), visit);
+        offset += bytes;
+    }
+    decodeEntries(buffer->getBuffer().data(), bufferedBytes, visit);
+}
+
+void ActionLog::print(std::ostream &out) const
+{
+    forEach([&out](const string &command, ActionStatus status)
+            { out << command << ' ' << actionStatusToString(status) << '\n'; });
+}
+
+void ActionLog::encodeWord(const char *text, size_t length)
+{
+    buffer->writeUnsigned(static_cast<uint64_t>(words->intern(text, length)) << 2 | WordField);
+}
+
+void ActionLog::decodeEntries(const char *data, size_t size, const std::function<void(const string &command, ActionStatus status)> &visit) const
+{
+    SnapshotReader in(data, size);
+    string command;
+    while (!in.atEnd())
+    {
+        command.clear();
+        for (size_t fields = 0;; ++fields)
+        {
+            uint64_t value = in.readUnsigned();
+            uint64_t field = value & 3;
+            if (field == CompletedEnd || field == ErrorEnd)
+            {
+                visit(command, field == ErrorEnd ? ActionStatus::ERROR : ActionStatus::COMPLETED);
+                break;
+            }
+            if (fields > 0)
+            {
+                command.push_back(' ');
+            }
+            if (field == NumberField)
+            {
+                command += std::to_string(value >> 2);
+            }
+            else
+            {
+                command += (*words)[static_cast<size_t>(value >> 2)];
+            }
+        }
+    }
+}
+
+void ActionLog::spillBuffer()
+{
+    try
+    {
+        if (!spill)
+        {
+            spill = std::make_shared<SpillFile>();
+        }
+        else if (spill->size() != spilledBytes)
+        {
+            // A copy of this log spilled since they parted, go on in a file of our own
+            std::shared_ptr<SpillFile> own = std::make_shared<SpillFile>();
+            string segment;
+            uint64_t offset = 0;
+            for (uint64_t bytes : segments)
+            {
+                segment.resize(static_cast<size_t>(bytes));
+                spill->read(offset, &segment[0], segment.size());
+                own->append(segment.data(), segment.size());
+                offset += bytes;
+            }
+            spill = own;
+        }
+        spill->append(buffer->getBuffer().data(), bufferedBytes);
+    }
+    catch (const std::runtime_error &)
+    {
+        // No usable temporary directory, the log stays in memory
+        spillThreshold = SIZE_MAX;
+        return;
+    }
+    segments.push_back(bufferedBytes);
+    spilledBytes += bufferedBytes;
+    // Copies still reading the old buffer keep it
+    if (buffer.use_count() == 1)
+    {
+        buffer->clear();
+    }
+    else
+    {
+        buffer = std::make_shared<SnapshotWriter>();
+    }
+    bufferedBytes = 0;
+}
@@ -1,4 +1,7 @@
 #include "Auxiliary.h"
+#include <cctype>
+#include <cstring>
+#include <limits>
 /*
 This is a 'static' method that receives a string(line) and returns a vector of the string's arguments.
 
@@ -81,3 +84,214 @@ SelectionPolicy *Auxiliary::createSelectionPolicy(const std::string &policy)
     }
     throw std::runtime_error("non existant policy");
 }
+
+// Argument implementation
+bool Argument::equals(const char *text) const
+{
+    return std::strlen(text) == size && std::memcmp(data, text, size) == 0;
+}
+
+std::string Argument::toString() const
+{
+    return std::string(data, size);
+}
+
+// ArgumentList implementation
+ArgumentList::ArgumentList() : arguments() {}
+
+void ArgumentList::parse(const std::string &line)
+{
+    parse(line.data(), line.data() + line.size());
+}
+
+void ArgumentList::parse(const char *begin, const char *end)
+{
+    arguments.clear();
+    const char *current = begin;
+    while (current != end)
+    {
+        while (current != end && std::isspace(static_cast<unsigned char>(*current)))
+        {
+            ++current;
+        }
+        const char *start = current;
+        while (current != end && !std::isspace(static_cast<unsigned char>(*current)))
+        {
+            ++current;
+        }
+        if (current != start)
+        {
+            arguments.push_back(Argument{start, static_cast<size_t>(current - start)});
+        }
+    }
+}
+
+size_t ArgumentList::size() const
+{
+    return arguments.size();
+}
+
+bool ArgumentList::empty() const
+{
+    return arguments.empty();
+}
+
+const Argument &ArgumentList::operator[](size_t index) const
+{
+    return arguments[index];
+}
+
+CommandType Auxiliary::parseCommand(const Argument &command)
+{
+    // Switch on the length first, so a command name is compared against at most four candidates
+    switch (command.size)
+    {
+    case 3:
+        if (command.equals("log"))
+            return CommandType::LOG;
+        break;
+    case 4:
+        if (command.equals("step"))
+            return CommandType::STEP;
+        if (command.equals("plan"))
+            return CommandType::PLAN;
+        if (command.equals("save"))
+            return CommandType::SAVE;
+        if (command.equals("load"))
+            return CommandType::LOAD;
+        break;
+    case 5:
+        if (command.equals("close"))
+            return CommandType::CLOSE;
+        if (command.equals("stats"))
+            return CommandType::STATS;
+        if (command.equals("trace"))
+            return CommandType::TRACE;
+        break;
+    case 6:
+        if (command.equals("backup"))
+            return CommandType::BACKUP;
+        if (command.equals("advise"))
+            return CommandType::ADVISE;
+        break;
+    case 7:
+        if (command.equals("restore"))
+            return CommandType::RESTORE;
+        if (command.equals("profile"))
+            return CommandType::PROFILE;
+        break;
+    case 8:
+        if (command.equals("facility"))
+            return CommandType::FACILITY;
+        break;
+    case 10:
+        if (command.equals("settlement"))
+            return CommandType::SETTLEMENT;
+        if (command.equals("planStatus"))
+            return CommandType::PLAN_STATUS;
+        break;
+    case 12:
+        if (command.equals("changePolicy"))
+            return CommandType::CHANGE_POLICY;
+        break;
+    }
+    return CommandType::UNKNOWN;
+}
+
+const char *Auxiliary::commandName(CommandType type)
+{
+    switch (type)
+    {
+    case CommandType::STEP:
+        return "step";
+    case CommandType::PLAN:
+        return "plan";
+    case CommandType::SETTLEMENT:
+        return "settlement";
+    case CommandType::FACILITY:
+        return "facility";
+    case CommandType::PLAN_STATUS:
+        return "planStatus";
+    case CommandType::CHANGE_POLICY:
+        return "changePolicy";
+    case CommandType::LOG:
+        return "log";
+    case CommandType::CLOSE:
+        return "close";
+    case CommandType::BACKUP:
+        return "backup";
+    case CommandType::RESTORE:
+        return "restore";
+    case CommandType::SAVE:
+        return "save";
+    case CommandType::LOAD:
+        return "load";
+    case CommandType::STATS:
+        return "stats";
+    case CommandType::TRACE:
+        return "trace";
+    case CommandType::PROFILE:
+        return "profile";
+    case CommandType::ADVISE:
+        return "advise";
+    default:
+        return "unknown";
+    }
+}
+
+bool Auxiliary::parseInt(const Argument &argument, int &value)
+{
+    const char *current = argument.data;
+    const char *end = current + argument.size;
+    bool negative = current != end && *current == '-';
+    if (current != end && (*current == '-' || *current == '+'))
+    {
+        ++current;
+    }
+    if (current == end)
+    {
+        return false;
+    }
+
+    long long result = 0;
+    for (; current != end; ++current)
+    {
+        if (*current < '0' || *current > '9')
+        {
+            return false;
+        }
+        result = result * 10 + (*current - '0');
+        if (result > static_cast<long long>(std::numeric_limits<int>::max()) + 1)
+        {
+            return false;
+        }
+    }
+    result = negative ? -result : result;
+    if (result > std::numeric_limits<int>::max())
+    {
+        return false;
+    }
+    value = static_cast<int>(result);
+    return true;
+}
+
+bool Auxiliary::parseSettlementType(const Argument &argument, SettlementType &type)
+{
+    if (argument.size != 1 || argument.data[0] < '0' || argument.data[0] > '2')
+    {
+        return false;
+    }
+    // Settlement types are stored one higher than in the input, see SettlementType
+    type = static_cast<SettlementType>(argument.data[0] - '0' + 1);
+    return true;
+}
+
+bool Auxiliary::parseFacilityCategory(const Argument &argument, FacilityCategory &category)
+{
+    if (argument.size != 1 || argument.data[0] < '0' || argument.data[0] > '2')
+    {
+        return false;
+    }
+    category = static_cast<FacilityCategory>(argument.data[0] - '0');
+    return true;
+}
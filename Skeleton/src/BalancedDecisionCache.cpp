@@ -0,0 +1,73 @@
+#include "BalancedDecisionCache.h"
+
+BalancedDecisionCache::BalancedDecisionCache() : stripes(), baseHits(0), baseMisses(0), invalidations(0) {}
+
+BalancedDecisionCache::BalancedDecisionCache(const Stats &previous)
+    : stripes(), baseHits(previous.hits), baseMisses(previous.misses), invalidations(previous.invalidations + (previous.entries > 0 ? 1 : 0)) {}
+
+uint64_t BalancedDecisionCache::makeKey(int lifeQualityScore, int economyScore, int environmentScore)
+{
+    uint32_t lifeMinusEconomy = static_cast<uint32_t>(lifeQualityScore) - static_cast<uint32_t>(economyScore);
+    uint32_t lifeMinusEnvironment = static_cast<uint32_t>(lifeQualityScore) - static_cast<uint32_t>(environmentScore);
+    return static_cast<uint64_t>(lifeMinusEconomy) << 32 | lifeMinusEnvironment;
+}
+
+bool BalancedDecisionCache::find(uint64_t key, size_t &facilityIndex)
+{
+    Stripe &stripe = stripeFor(key);
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    auto found = stripe.decisions.find(key);
+    if (found == stripe.decisions.end())
+    {
+        ++stripe.misses;
+        return false;
+    }
+    ++stripe.hits;
+    facilityIndex = found->second;
+    return true;
+}
+
+void BalancedDecisionCache::insert(uint64_t key, size_t facilityIndex)
+{
+    Stripe &stripe = stripeFor(key);
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    if (stripe.decisions.size() >= MaxStripeEntries)
+    {
+        stripe.decisions.clear();
+    }
+    stripe.decisions[key] = facilityIndex;
+}
+
+void BalancedDecisionCache::invalidate()
+{
+    bool dropped = false;
+    for (Stripe &stripe : stripes)
+    {
+        dropped = dropped || !stripe.decisions.empty();
+        stripe.decisions.clear();
+    }
+    if (dropped)
+    {
+        ++invalidations;
+    }
+}
+
+BalancedDecisionCache::Stats BalancedDecisionCache::getStats() const
+{
+    Stats stats = {baseHits, baseMisses, 0, invalidations};
+    for (const Stripe &stripe : stripes)
+    {
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        stats.hits += stripe.hits;
+        stats.misses += stripe.misses;
+        stats.entries += stripe.decisions.size();
+    }
+    return stats;
+}
+
+BalancedDecisionCache::Stripe &BalancedDecisionCache::stripeFor(uint64_t key)
+{
+    // Mix both halves, neighbouring difference states land on different stripes
+    uint64_t hash = key * 0x9e3779b97f4a7c15ULL;
+    return stripes[hash >> 60];
+}
@@ -0,0 +1,182 @@
+#include "BalancedKernel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BALANCED_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// Continues a search from (bestDistance, bestIndex) over [begin, count)
+static size_t findScalar(const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t begin, size_t count,
+                         int lifeQualityScore, int economyScore, int environmentScore, int bestDistance, size_t bestIndex)
+{
+    for (size_t i = begin; i < count; ++i)
+    {
+        int life = lifeQualityScores[i] + lifeQualityScore;
+        int eco = economyScores[i] + economyScore;
+        int env = environmentScores[i] + environmentScore;
+        int distance = std::max({std::abs(life - eco), std::abs(life - env), std::abs(eco - env)});
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+// Folds the per-lane minimums of a vector kernel into one, lowest index first
+static void reduceLanes(const int *distances, const int *indexes, int lanes, int &bestDistance, size_t &bestIndex)
+{
+    bestDistance = std::numeric_limits<int>::max();
+    bestIndex = 0;
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        size_t index = static_cast<size_t>(indexes[lane]);
+        if (distances[lane] < bestDistance || (distances[lane] == bestDistance && index < bestIndex))
+        {
+            bestDistance = distances[lane];
+            bestIndex = index;
+        }
+    }
+}
+
+#ifdef BALANCED_KERNEL_X86
+// Each lane keeps the first minimum it saw, so ties resolve to the lowest index after reduceLanes
+__attribute__((target("sse4.1"))) static size_t findSse41(const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                                          int lifeQualityScore, int economyScore, int environmentScore)
+{
+    const __m128i lifeOffset = _mm_set1_epi32(lifeQualityScore);
+    const __m128i ecoOffset = _mm_set1_epi32(economyScore);
+    const __m128i envOffset = _mm_set1_epi32(environmentScore);
+    const __m128i stride = _mm_set1_epi32(4);
+    __m128i best = _mm_set1_epi32(std::numeric_limits<int>::max());
+    __m128i bestIndexes = _mm_setzero_si128();
+    __m128i indexes = _mm_setr_epi32(0, 1, 2, 3);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i life = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lifeQualityScores + i)), lifeOffset);
+        __m128i eco = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(economyScores + i)), ecoOffset);
+        __m128i env = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(environmentScores + i)), envOffset);
+        __m128i distance = _mm_max_epi32(_mm_abs_epi32(_mm_sub_epi32(life, eco)),
+                                         _mm_max_epi32(_mm_abs_epi32(_mm_sub_epi32(life, env)), _mm_abs_epi32(_mm_sub_epi32(eco, env))));
+        __m128i better = _mm_cmplt_epi32(distance, best);
+        best = _mm_blendv_epi8(best, distance, better);
+        bestIndexes = _mm_blendv_epi8(bestIndexes, indexes, better);
+        indexes = _mm_add_epi32(indexes, stride);
+    }
+
+    alignas(16) int distances[4];
+    alignas(16) int lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(distances), best);
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), bestIndexes);
+    int bestDistance;
+    size_t bestIndex;
+    reduceLanes(distances, lanes, 4, bestDistance, bestIndex);
+    return findScalar(lifeQualityScores, economyScores, environmentScores, i, count, lifeQualityScore, economyScore, environmentScore, bestDistance, bestIndex);
+}
+
+__attribute__((target("avx2"))) static size_t findAvx2(const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                                       int lifeQualityScore, int economyScore, int environmentScore)
+{
+    const __m256i lifeOffset = _mm256_set1_epi32(lifeQualityScore);
+    const __m256i ecoOffset = _mm256_set1_epi32(economyScore);
+    const __m256i envOffset = _mm256_set1_epi32(environmentScore);
+    const __m256i stride = _mm256_set1_epi32(8);
+    __m256i best = _mm256_set1_epi32(std::numeric_limits<int>::max());
+    __m256i bestIndexes = _mm256_setzero_si256();
+    __m256i indexes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i life = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(lifeQualityScores + i)), lifeOffset);
+        __m256i eco = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(economyScores + i)), ecoOffset);
+        __m256i env = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(environmentScores + i)), envOffset);
+        __m256i distance = _mm256_max_epi32(_mm256_abs_epi32(_mm256_sub_epi32(life, eco)),
+                                            _mm256_max_epi32(_mm256_abs_epi32(_mm256_sub_epi32(life, env)), _mm256_abs_epi32(_mm256_sub_epi32(eco, env))));
+        __m256i better = _mm256_cmpgt_epi32(best, distance);
+        best = _mm256_blendv_epi8(best, distance, better);
+        bestIndexes = _mm256_blendv_epi8(bestIndexes, indexes, better);
+        indexes = _mm256_add_epi32(indexes, stride);
+    }
+
+    alignas(32) int distances[8];
+    alignas(32) int lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(distances), best);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), bestIndexes);
+    int bestDistance;
+    size_t bestIndex;
+    reduceLanes(distances, lanes, 8, bestDistance, bestIndex);
+    return findScalar(lifeQualityScores, economyScores, environmentScores, i, count, lifeQualityScore, economyScore, environmentScore, bestDistance, bestIndex);
+}
+#endif
+
+size_t BalancedKernel::findMostBalanced(const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                        int lifeQualityScore, int economyScore, int environmentScore)
+{
+    static const Implementation implementation = best();
+    return findMostBalanced(implementation, lifeQualityScores, economyScores, environmentScores, count, lifeQualityScore, economyScore, environmentScore);
+}
+
+size_t BalancedKernel::findMostBalanced(Implementation implementation, const int *lifeQualityScores, const int *economyScores, const int *environmentScores, size_t count,
+                                        int lifeQualityScore, int economyScore, int environmentScore)
+{
+    switch (implementation)
+    {
+#ifdef BALANCED_KERNEL_X86
+    case Implementation::AVX2:
+        return findAvx2(lifeQualityScores, economyScores, environmentScores, count, lifeQualityScore, economyScore, environmentScore);
+    case Implementation::SSE41:
+        return findSse41(lifeQualityScores, economyScores, environmentScores, count, lifeQualityScore, economyScore, environmentScore);
+#endif
+    default:
+        return findScalar(lifeQualityScores, economyScores, environmentScores, 0, count, lifeQualityScore, economyScore, environmentScore,
+                          std::numeric_limits<int>::max(), 0);
+    }
+}
+
+bool BalancedKernel::isSupported(Implementation implementation)
+{
+    switch (implementation)
+    {
+#ifdef BALANCED_KERNEL_X86
+    case Implementation::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case Implementation::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    case Implementation::SCALAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+BalancedKernel::Implementation BalancedKernel::best()
+{
+    if (isSupported(Implementation::AVX2))
+    {
+        return Implementation::AVX2;
+    }
+    if (isSupported(Implementation::SSE41))
+    {
+        return Implementation::SSE41;
+    }
+    return Implementation::SCALAR;
+}
+
+const char *BalancedKernel::toString(Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Implementation::AVX2:
+        return "avx2";
+    case Implementation::SSE41:
+        return "sse4.1";
+    default:
+        return "scalar";
+    }
+}
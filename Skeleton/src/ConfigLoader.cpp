@@ -0,0 +1,233 @@
+#include "ConfigLoader.h"
+#include "Auxiliary.h"
+#include "SelectionPolicy.h"
+#include "Simulation.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+#include "Tracer.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+enum class RecordKind
+{
+    SETTLEMENT,
+    FACILITY,
+    PLAN,
+    THREADS,
+    ERROR,
+};
+
+// One parsed config line, ready to be applied to the simulation
+struct ConfigRecord
+{
+    ConfigRecord(RecordKind kind, size_t line) : kind(kind), line(line), settlement(), facility(0), policy(), settlementName(), threads(0), error() {}
+
+    RecordKind kind;
+    size_t line; // Line number inside the chunk, from 1
+    std::unique_ptr<Settlement> settlement;
+    size_t facility; // Position in ConfigChunk::facilities
+    std::unique_ptr<SelectionPolicy> policy;
+    string settlementName;
+    int threads;
+    string error;
+};
+
+struct ConfigChunk
+{
+    ConfigChunk() : begin(nullptr), end(nullptr), lines(0), records(), facilities() {}
+    ConfigChunk(const ConfigChunk &other) = delete;
+    ConfigChunk &operator=(const ConfigChunk &other) = delete;
+
+    const char *begin;
+    const char *end;
+    size_t lines;
+    vector<ConfigRecord> records;
+    vector<FacilityType> facilities;
+};
+
+static void parseChunk(ConfigChunk &chunk)
+{
+    TraceSpan span("ConfigLoader::parseChunk", "config");
+    ArgumentList arguments;
+    const char *lineBegin = chunk.begin;
+    while (lineBegin < chunk.end)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(lineBegin, '\n', chunk.end - lineBegin));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = chunk.end;
+        }
+        size_t line = ++chunk.lines;
+        arguments.parse(lineBegin, lineEnd);
+        lineBegin = lineEnd + 1;
+        if (arguments.empty())
+        {
+            continue;
+        }
+
+        const Argument &command = arguments[0];
+        if (command.equals("settlement"))
+        {
+            if (arguments.size() >= 3)
+            {
+                SettlementType type;
+                chunk.records.emplace_back(RecordKind::SETTLEMENT, line);
+                if (!Auxiliary::parseSettlementType(arguments[2], type))
+                {
+                    chunk.records.back().kind = RecordKind::ERROR;
+                    chunk.records.back().error = "Invalid settlement type";
+                    continue;
+                }
+                chunk.records.back().settlement.reset(new Settlement(arguments[1].toString(), type));
+            }
+        }
+        else if (command.equals("facility"))
+        {
+            if (arguments.size() >= 7)
+            {
+                FacilityCategory category;
+                int price, lifeQualityImpact, ecoImpact, envImpact;
+                chunk.records.emplace_back(RecordKind::FACILITY, line);
+                if (!Auxiliary::parseFacilityCategory(arguments[2], category) ||
+                    !Auxiliary::parseInt(arguments[3], price) ||
+                    !Auxiliary::parseInt(arguments[4], lifeQualityImpact) ||
+                    !Auxiliary::parseInt(arguments[5], ecoImpact) ||
+                    !Auxiliary::parseInt(arguments[6], envImpact))
+                {
+                    chunk.records.back().kind = RecordKind::ERROR;
+                    chunk.records.back().error = "Invalid facility";
+                    continue;
+                }
+                chunk.records.back().facility = chunk.facilities.size();
+                chunk.facilities.push_back(FacilityType(arguments[1].toString(), category, price, lifeQualityImpact, ecoImpact, envImpact));
+            }
+        }
+        else if (command.equals("plan"))
+        {
+            if (arguments.size() >= 3)
+            {
+                chunk.records.emplace_back(RecordKind::PLAN, line);
+                try
+                {
+                    chunk.records.back().policy.reset(Auxiliary::createSelectionPolicy(arguments[2].toString()));
+                    chunk.records.back().settlementName = arguments[1].toString();
+                }
+                catch (const std::exception &e)
+                {
+                    chunk.records.back().kind = RecordKind::ERROR;
+                    chunk.records.back().error = e.what();
+                }
+            }
+        }
+        else if (command.equals("threads"))
+        {
+            if (arguments.size() >= 2)
+            {
+                chunk.records.emplace_back(RecordKind::THREADS, line);
+                if (!Auxiliary::parseInt(arguments[1], chunk.records.back().threads))
+                {
+                    chunk.records.back().kind = RecordKind::ERROR;
+                    chunk.records.back().error = "Invalid thread count";
+                }
+            }
+        }
+    }
+}
+
+ConfigLoader::ConfigLoader(const string &configFilePath) : configFilePath(configFilePath) {}
+
+ConfigLoadStats ConfigLoader::loadInto(Simulation &simulation) const
+{
+    TraceSpan span("ConfigLoader::loadInto", "config");
+    ProfiledPhase phase(ProfilePhase::CONFIG_LOAD);
+    auto begin = std::chrono::steady_clock::now();
+    std::unique_ptr<MappedFile> file;
+    try
+    {
+        file.reset(new MappedFile(configFilePath));
+    }
+    catch (const std::runtime_error &)
+    {
+        throw std::runtime_error("Could not open config file");
+    }
+
+    // Cut the file into chunks that end right after a newline
+    int threads = file->size() < MinParallelBytes ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = threads == 1 ? 1 : static_cast<size_t>(threads) * 4;
+    vector<ConfigChunk> chunks(chunkCount);
+    const char *data = file->data();
+    const char *end = data + file->size();
+    const char *chunkBegin = data;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        const char *chunkEnd = i + 1 == chunkCount ? end : std::max(chunkBegin, data + file->size() / chunkCount * (i + 1));
+        if (chunkEnd != end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = newline == nullptr ? end : newline + 1;
+        }
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = chunkEnd;
+        chunkBegin = chunkEnd;
+    }
+
+    if (threads > 1)
+    {
+        WorkStealingPool pool(threads);
+        pool.parallelFor(chunks.size(), [&chunks](size_t i)
+                         { parseChunk(chunks[i]); });
+    }
+    else
+    {
+        parseChunk(chunks[0]);
+    }
+
+    // Apply in file order, line numbers are global from here on
+    size_t lineBase = 0;
+    for (ConfigChunk &chunk : chunks)
+    {
+        for (ConfigRecord &record : chunk.records)
+        {
+            switch (record.kind)
+            {
+            case RecordKind::SETTLEMENT:
+            {
+                Settlement *settlement = record.settlement.release();
+                if (!simulation.addSettlement(settlement))
+                {
+                    delete settlement;
+                    throw std::runtime_error("Settlement already exists");
+                }
+                break;
+            }
+            case RecordKind::FACILITY:
+                simulation.addFacility(chunk.facilities[record.facility]);
+                break;
+            case RecordKind::PLAN:
+            {
+                const Settlement &settlement = simulation.getSettlement(record.settlementName);
+                simulation.addPlan(settlement, record.policy.release());
+                break;
+            }
+            case RecordKind::THREADS:
+                simulation.setThreads(record.threads);
+                break;
+            case RecordKind::ERROR:
+                throw std::runtime_error(record.error + " on config line " + std::to_string(lineBase + record.line));
+            }
+        }
+        lineBase += chunk.lines;
+    }
+
+    ConfigLoadStats stats;
+    stats.bytes = file->size();
+    stats.lines = lineBase;
+    stats.threads = threads;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
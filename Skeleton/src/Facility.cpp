@@ -35,15 +35,15 @@ FacilityCategory FacilityType::getCategory() const
 }
 
 // Facility class implementation
-Facility::Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score)
-    : FacilityType(name, category, price, lifeQuality_score, economy_score, environment_score), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(price) {}
+Facility::Facility()
+    : typeId(0), timeLeft(0), status(FacilityStatus::OPERATIONAL) {}
 
-Facility::Facility(const FacilityType &type, const string &settlementName)
-    : FacilityType(type), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(type.getCost()) {}
+Facility::Facility(size_t typeId, int buildTime)
+    : typeId(static_cast<uint32_t>(typeId)), timeLeft(buildTime), status(FacilityStatus::UNDER_CONSTRUCTIONS) {}
 
-const string &Facility::getSettlementName() const
+size_t Facility::getTypeId() const
 {
-    return settlementName;
+    return typeId;
 }
 
 const int Facility::getTimeLeft() const
@@ -67,6 +67,14 @@ FacilityStatus Facility::step()
     return status;
 }
 
+void Facility::advance(int steps)
+{
+    if (status == FacilityStatus::UNDER_CONSTRUCTIONS && timeLeft > 0 && steps > 0)
+    {
+        timeLeft -= steps;
+    }
+}
+
 void Facility::setStatus(FacilityStatus status)
 {
     this->status = status;
@@ -77,7 +85,7 @@ const FacilityStatus &Facility::getStatus() const
     return status;
 }
 
-const string Facility::toString() const
+const string Facility::toString(const FacilityType &type) const
 {
-    return "Facility: " + getName() + ", Settlement: " + settlementName + ", Status: " + (status == FacilityStatus::UNDER_CONSTRUCTIONS ? "Under Construction" : "Operational");
+    return "Facility: " + type.getName() + ", Status: " + (status == FacilityStatus::UNDER_CONSTRUCTIONS ? "Under Construction" : "Operational");
 }
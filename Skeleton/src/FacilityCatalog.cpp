@@ -0,0 +1,88 @@
+#include "FacilityCatalog.h"
+#include <stdexcept>
+
+FacilityCatalog::FacilityCatalog() : facilities(), categories(), lifeQualityScores(), economyScores(), environmentScores(), indexesByName(), balancedDecisions(std::make_shared<BalancedDecisionCache>()) {}
+
+bool FacilityCatalog::add(const FacilityType &facility)
+{
+    if (!indexesByName.emplace(facility.getName(), facilities.size()).second)
+    {
+        return false;
+    }
+    categories[static_cast<size_t>(facility.getCategory())].push_back(facilities.size());
+    lifeQualityScores.push_back(facility.getLifeQualityScore());
+    economyScores.push_back(facility.getEconomyScore());
+    environmentScores.push_back(facility.getEnvironmentScore());
+    facilities.push_back(facility);
+    // Decisions were made without this facility. A copy of the catalog may still
+    // use the old ones, so a shared cache is replaced instead of emptied.
+    if (balancedDecisions.use_count() > 1)
+    {
+        balancedDecisions = std::make_shared<BalancedDecisionCache>(balancedDecisions->getStats());
+    }
+    else
+    {
+        balancedDecisions->invalidate();
+    }
+    return true;
+}
+
+bool FacilityCatalog::contains(const string &name) const
+{
+    return indexesByName.count(name) != 0;
+}
+
+size_t FacilityCatalog::indexOf(const string &name) const
+{
+    auto found = indexesByName.find(name);
+    if (found == indexesByName.end())
+    {
+        throw std::runtime_error("Facility not found");
+    }
+    return found->second;
+}
+
+size_t FacilityCatalog::size() const
+{
+    return facilities.size();
+}
+
+bool FacilityCatalog::empty() const
+{
+    return facilities.empty();
+}
+
+const FacilityType &FacilityCatalog::operator[](size_t index) const
+{
+    return facilities[index];
+}
+
+const vector<FacilityType> &FacilityCatalog::getFacilities() const
+{
+    return facilities;
+}
+
+const vector<size_t> &FacilityCatalog::getCategory(FacilityCategory category) const
+{
+    return categories[static_cast<size_t>(category)];
+}
+
+const vector<int> &FacilityCatalog::getLifeQualityScores() const
+{
+    return lifeQualityScores;
+}
+
+const vector<int> &FacilityCatalog::getEconomyScores() const
+{
+    return economyScores;
+}
+
+const vector<int> &FacilityCatalog::getEnvironmentScores() const
+{
+    return environmentScores;
+}
+
+BalancedDecisionCache &FacilityCatalog::getBalancedDecisions() const
+{
+    return *balancedDecisions;
+}
@@ -0,0 +1,179 @@
+#include "Journal.h"
+#include "Snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+const size_t Journal::GroupSize;
+const int Journal::GroupMilliseconds;
+
+static void writeAll(int descriptor, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(descriptor, data, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw std::runtime_error("Could not write the journal");
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+Journal::Journal(const string &path)
+    : path(path), checkpointPath(path + ".checkpoint"), descriptor(-1), nextSequence(0), unsynced(0), lastSync(std::chrono::steady_clock::now()), record(), stats()
+{
+    descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error("Could not open journal " + path);
+    }
+}
+
+Journal::~Journal()
+{
+    try
+    {
+        sync();
+    }
+    catch (const std::runtime_error &)
+    {
+        // Nothing left to report to
+    }
+    ::close(descriptor);
+}
+
+const string &Journal::getCheckpointPath() const
+{
+    return checkpointPath;
+}
+
+uint64_t Journal::replay(uint64_t from, const std::function<void(const string &command)> &visit)
+{
+    nextSequence = from;
+    MappedFile file(path);
+    const char *begin = file.data();
+    const char *end = begin + file.size();
+    const char *current = begin;
+    uint64_t visited = 0;
+    string command;
+    while (current != end)
+    {
+        const char *newline = current;
+        while (newline != end && *newline != '\n')
+        {
+            ++newline;
+        }
+        if (newline == end)
+        {
+            break; // Torn by a crash in the middle of a write
+        }
+        uint64_t sequence = 0;
+        const char *text = current;
+        while (text != newline && *text >= '0' && *text <= '9')
+        {
+            sequence = sequence * 10 + static_cast<uint64_t>(*text++ - '0');
+        }
+        if (text == current || text == newline || *text != ' ')
+        {
+            throw std::runtime_error("Journal is corrupted");
+        }
+        // Records up to the checkpoint are left over from a crash before the journal was emptied
+        if (sequence >= nextSequence)
+        {
+            if (sequence != nextSequence)
+            {
+                throw std::runtime_error("Journal is missing records");
+            }
+            command.assign(text + 1, newline);
+            visit(command);
+            ++nextSequence;
+            ++visited;
+        }
+        current = newline + 1;
+    }
+    if (current != end && ::truncate(path.c_str(), static_cast<off_t>(current - begin)) != 0)
+    {
+        throw std::runtime_error("Could not repair journal " + path);
+    }
+    return visited;
+}
+
+void Journal::append(const string &command)
+{
+    record = std::to_string(nextSequence);
+    record.push_back(' ');
+    record.append(command);
+    record.push_back('\n');
+    writeAll(descriptor, record.data(), record.size());
+    ++nextSequence;
+    ++stats.records;
+    ++unsynced;
+    if (unsynced >= GroupSize || std::chrono::steady_clock::now() - lastSync >= std::chrono::milliseconds(GroupMilliseconds))
+    {
+        sync();
+    }
+}
+
+void Journal::sync()
+{
+    if (unsynced == 0)
+    {
+        return;
+    }
+    if (::fdatasync(descriptor) != 0)
+    {
+        throw std::runtime_error("Could not sync the journal");
+    }
+    unsynced = 0;
+    lastSync = std::chrono::steady_clock::now();
+    ++stats.syncs;
+}
+
+void Journal::checkpoint(const SnapshotWriter &state)
+{
+    try
+    {
+        state.saveToFile(checkpointPath);
+    }
+    catch (const std::runtime_error &)
+    {
+        throw std::runtime_error("Could not write checkpoint " + checkpointPath);
+    }
+    empty();
+    ++stats.checkpoints;
+}
+
+void Journal::discard()
+{
+    std::remove(checkpointPath.c_str());
+    empty();
+    nextSequence = 0;
+}
+
+uint64_t Journal::getNextSequence() const
+{
+    return nextSequence;
+}
+
+Journal::Stats Journal::getStats() const
+{
+    return stats;
+}
+
+void Journal::empty()
+{
+    if (::ftruncate(descriptor, 0) != 0 || ::fsync(descriptor) != 0)
+    {
+        throw std::runtime_error("Could not empty journal " + path);
+    }
+    unsynced = 0;
+    lastSync = std::chrono::steady_clock::now();
+}
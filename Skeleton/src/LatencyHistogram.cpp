@@ -0,0 +1,93 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+static const uint64_t ExactValues = uint64_t(1) << LatencyHistogram::SubBucketBits;
+static const uint64_t HalfBuckets = ExactValues / 2; // Buckets per power of two above the exact values
+static const uint64_t MaxValue = (uint64_t(1) << LatencyHistogram::MaxValueBits) - 1;
+static const size_t BucketCount = ExactValues + (LatencyHistogram::MaxValueBits - LatencyHistogram::SubBucketBits) * HalfBuckets;
+
+LatencyHistogram::LatencyHistogram() : counts(BucketCount, 0), count(0), total(0), min(0), max(0) {}
+
+void LatencyHistogram::record(uint64_t value)
+{
+    value = std::min(value, MaxValue);
+    ++counts[bucketOf(value)];
+    min = count == 0 ? value : std::min(min, value);
+    max = std::max(max, value);
+    ++count;
+    total += value;
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    count = 0;
+    total = 0;
+    min = 0;
+    max = 0;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+uint64_t LatencyHistogram::getMin() const
+{
+    return min;
+}
+
+uint64_t LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+double LatencyHistogram::getMean() const
+{
+    return count > 0 ? static_cast<double>(total) / count : 0;
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    double rank = std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100 * count);
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(rank));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < counts.size(); ++bucket)
+    {
+        seen += counts[bucket];
+        if (seen >= target)
+        {
+            return std::min(highestValueIn(bucket), max);
+        }
+    }
+    return max;
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < ExactValues)
+    {
+        return static_cast<size_t>(value);
+    }
+    // The top SubBucketBits bits of the value pick the bucket within its power of two
+    int magnitude = 63 - __builtin_clzll(value);
+    int shift = magnitude - (SubBucketBits - 1);
+    return static_cast<size_t>(ExactValues + (magnitude - SubBucketBits) * HalfBuckets + ((value >> shift) - HalfBuckets));
+}
+
+uint64_t LatencyHistogram::highestValueIn(size_t bucket)
+{
+    if (bucket < ExactValues)
+    {
+        return bucket;
+    }
+    uint64_t index = bucket - ExactValues;
+    int shift = static_cast<int>(index / HalfBuckets) + 1;
+    uint64_t top = index % HalfBuckets + HalfBuckets;
+    return ((top + 1) << shift) - 1;
+}
@@ -0,0 +1,178 @@
+#include "ObjectPool.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+static const size_t Granularity = 16;
+static const size_t ClassCount = ObjectPool::MaxPooledSize / Granularity;
+static const size_t BlockSize = 64 * 1024;
+
+struct FreeObject
+{
+    FreeObject *next;
+};
+
+// Free lists given up by exited threads, taken whole by the next thread that runs dry
+static std::mutex orphanLock;
+static FreeObject *orphans[ClassCount];
+static std::atomic<bool> hasOrphans[ClassCount]; // Checked without the lock first
+static std::atomic<size_t> blockCount(0);
+static std::atomic<uint64_t> allocationCount(0); // Relaxed, it is only read for statistics
+
+// Set once this thread's cache is destroyed. A plain bool needs no destructor
+// of its own, so it can still be read by static destructors that run later.
+static thread_local bool cacheRetired = false;
+
+static size_t classOf(size_t size)
+{
+    return size == 0 ? 0 : (size - 1) / Granularity;
+}
+
+static void orphan(FreeObject *object, size_t sizeClass)
+{
+    std::lock_guard<std::mutex> guard(orphanLock);
+    object->next = orphans[sizeClass];
+    orphans[sizeClass] = object;
+    hasOrphans[sizeClass] = true;
+}
+
+class ThreadCache
+{
+public:
+    ThreadCache() : freeLists(), next(), end() {}
+    ThreadCache(const ThreadCache &other) = delete;
+    ThreadCache &operator=(const ThreadCache &other) = delete;
+
+    ~ThreadCache()
+    {
+        // Unused space at the end of a block is lost, the free objects are not.
+        // Objects freed later on this thread (static destructors) go straight to the
+        // orphans, see cacheRetired.
+        std::lock_guard<std::mutex> guard(orphanLock);
+        for (size_t sizeClass = 0; sizeClass < ClassCount; ++sizeClass)
+        {
+            FreeObject *head = freeLists[sizeClass];
+            if (head == nullptr)
+            {
+                continue;
+            }
+            FreeObject *tail = head;
+            while (tail->next != nullptr)
+            {
+                tail = tail->next;
+            }
+            tail->next = orphans[sizeClass];
+            orphans[sizeClass] = head;
+            hasOrphans[sizeClass] = true;
+            freeLists[sizeClass] = nullptr;
+        }
+        cacheRetired = true;
+    }
+
+    void *allocate(size_t sizeClass)
+    {
+        FreeObject *object = freeLists[sizeClass];
+        if (object == nullptr && hasOrphans[sizeClass])
+        {
+            object = adoptOrphans(sizeClass);
+        }
+        if (object != nullptr)
+        {
+            freeLists[sizeClass] = object->next;
+            return object;
+        }
+
+        size_t objectSize = (sizeClass + 1) * Granularity;
+        if (next[sizeClass] == end[sizeClass])
+        {
+            char *block = static_cast<char *>(::operator new(BlockSize));
+            ++blockCount;
+            next[sizeClass] = block;
+            end[sizeClass] = block + BlockSize / objectSize * objectSize;
+        }
+        void *memory = next[sizeClass];
+        next[sizeClass] += objectSize;
+        return memory;
+    }
+
+    void deallocate(void *memory, size_t sizeClass)
+    {
+        FreeObject *object = static_cast<FreeObject *>(memory);
+        object->next = freeLists[sizeClass];
+        freeLists[sizeClass] = object;
+    }
+
+private:
+    FreeObject *freeLists[ClassCount];
+    char *next[ClassCount];
+    char *end[ClassCount];
+
+    FreeObject *adoptOrphans(size_t sizeClass)
+    {
+        std::lock_guard<std::mutex> guard(orphanLock);
+        FreeObject *list = orphans[sizeClass];
+        orphans[sizeClass] = nullptr;
+        hasOrphans[sizeClass] = false;
+        return list;
+    }
+};
+
+static ThreadCache &threadCache()
+{
+    static thread_local ThreadCache cache;
+    return cache;
+}
+
+void *ObjectPool::allocate(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size > MaxPooledSize || !isEnabled())
+    {
+        return ::operator new(size);
+    }
+    if (cacheRetired)
+    {
+        // Sized like a pooled object, so it can join the orphans when freed
+        return ::operator new((classOf(size) + 1) * Granularity);
+    }
+    return threadCache().allocate(classOf(size));
+}
+
+void ObjectPool::deallocate(void *object, size_t size)
+{
+    if (object == nullptr)
+    {
+        return;
+    }
+    if (size > MaxPooledSize || !isEnabled())
+    {
+        ::operator delete(object);
+        return;
+    }
+    if (cacheRetired)
+    {
+        orphan(static_cast<FreeObject *>(object), classOf(size));
+        return;
+    }
+    threadCache().deallocate(object, classOf(size));
+}
+
+bool ObjectPool::isEnabled()
+{
+    static const bool enabled = []
+    {
+        const char *setting = std::getenv("SPL_POOL");
+        return setting == nullptr || std::strcmp(setting, "0") != 0;
+    }();
+    return enabled;
+}
+
+ObjectPool::Stats ObjectPool::getStats()
+{
+    Stats stats;
+    stats.blocks = blockCount;
+    stats.reservedBytes = stats.blocks * BlockSize;
+    stats.allocations = allocationCount.load(std::memory_order_relaxed);
+    return stats;
+}
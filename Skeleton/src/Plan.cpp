@@ -1,40 +1,34 @@
 #include "Plan.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+#include "Tracer.h"
 #include <iostream>
+#include <stdexcept>
 using namespace std;
 #include <utility> // For std::move
+#include <algorithm>
 
-Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
-    : plan_id(planId), settlement(settlement), selectionPolicy(selectionPolicy), status(PlanStatus::AVALIABLE), facilities(), underConstruction(), facilityOptions(facilityOptions), life_quality_score(0), economy_score(0), environment_score(0) {}
+Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy)
+    : plan_id(planId), status(PlanStatus::AVALIABLE), policyKind(selectionPolicy->kind()), constructionLimit(static_cast<unsigned char>(settlement.getType())), underConstruction(0), life_quality_score(0), economy_score(0), environment_score(0), building(), selectionPolicy(selectionPolicy), settlement(settlement), operationalRuns() {}
+
+static_assert(sizeof(Plan) <= 128, "A plan should span at most two cache lines");
 
 // Destructor
 Plan::~Plan()
 {
     delete selectionPolicy;
-
-    for (auto facility : facilities)
-    {
-        delete facility;
-    }
-    facilities.clear();
-    for (auto facility : underConstruction)
-    {
-        delete facility;
-    }
-    underConstruction.clear();
 }
 
 // Copy constructor
 Plan::Plan(const Plan &other)
-    : plan_id(other.plan_id), settlement(other.settlement), selectionPolicy(other.selectionPolicy->clone()), status(other.status), facilities(), underConstruction(), facilityOptions(other.facilityOptions), life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score)
+    : plan_id(other.plan_id), status(other.status), policyKind(other.policyKind), constructionLimit(other.constructionLimit), underConstruction(other.underConstruction), life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score), building(), selectionPolicy(nullptr), settlement(other.settlement), operationalRuns()
 {
     copyFrom(other);
 }
 
-// Copy counstructor 2
-Plan::Plan(const Plan &other, const Settlement &settlement, const vector<FacilityType> &facilityOptions)
-    : plan_id(other.plan_id), settlement(settlement), selectionPolicy(other.selectionPolicy->clone()), status(other.status), facilities(), underConstruction(), facilityOptions(facilityOptions), life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score)
+Plan::Plan(const Plan &other, SelectionPolicy *selectionPolicy) : Plan(other)
 {
-    copyFrom(other);
+    setSelectionPolicy(selectionPolicy);
 }
 
 // Copy assignment operator
@@ -44,16 +38,6 @@ Plan &Plan::operator=(const Plan &other)
     {
         // Clean up existing resources
         delete selectionPolicy;
-        for (auto facility : facilities)
-        {
-            delete facility;
-        }
-        facilities.clear();
-        for (auto facility : underConstruction)
-        {
-            delete facility;
-        }
-        underConstruction.clear();
         // Copy from other
         copyFrom(other);
     }
@@ -62,7 +46,7 @@ Plan &Plan::operator=(const Plan &other)
 
 // Move constructor
 Plan::Plan(Plan &&other) noexcept
-    : plan_id(other.plan_id), settlement(other.settlement), selectionPolicy(other.selectionPolicy), status(other.status), facilities(), underConstruction(), facilityOptions(other.facilityOptions), life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score)
+    : plan_id(other.plan_id), status(other.status), policyKind(other.policyKind), constructionLimit(other.constructionLimit), underConstruction(other.underConstruction), life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score), building(), selectionPolicy(other.selectionPolicy), settlement(other.settlement), operationalRuns()
 {
     moveFrom(std::move(other));
 }
@@ -74,17 +58,6 @@ Plan &Plan::operator=(Plan &&other) noexcept
     {
         // Clean up existing resources
         delete selectionPolicy;
-
-        for (auto facility : facilities)
-        {
-            delete facility;
-        }
-        facilities.clear();
-        for (auto facility : underConstruction)
-        {
-            delete facility;
-        }
-        underConstruction.clear();
         // Move from other
         moveFrom(std::move(other));
     }
@@ -108,7 +81,9 @@ const int Plan::getEnvironmentScore() const
 
 void Plan::setSelectionPolicy(SelectionPolicy *selectionPolicy)
 {
+    delete this->selectionPolicy;
     this->selectionPolicy = selectionPolicy;
+    policyKind = selectionPolicy->kind();
 }
 
 SelectionPolicy *Plan::getSelectionPolicy() const
@@ -116,74 +91,192 @@ SelectionPolicy *Plan::getSelectionPolicy() const
     return selectionPolicy;
 }
 
-void Plan::step()
+PolicyKind Plan::getPolicyKind() const
 {
-    if (status == PlanStatus::AVALIABLE)
+    return policyKind;
+}
+
+void Plan::step(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented)
+{
+    switch (policyKind)
     {
-        while (underConstruction.size() < static_cast<unsigned int>(settlement.getType()))
-        {
-            FacilityType nextFacilityType = selectionPolicy->selectFacility(facilityOptions);
-            Facility *nextFacility = new Facility(nextFacilityType, settlement.getName());
-            underConstruction.push_back(nextFacility);
-        }
+    case PolicyKind::NAIVE:
+        step<NaiveSelection>(facilityOptions, counts, instrumented);
+        break;
+    case PolicyKind::BALANCED:
+        step<BalancedSelection>(facilityOptions, counts, instrumented);
+        break;
+    case PolicyKind::ECONOMY:
+        step<EconomySelection>(facilityOptions, counts, instrumented);
+        break;
+    case PolicyKind::SUSTAINABILITY:
+        step<SustainabilitySelection>(facilityOptions, counts, instrumented);
+        break;
     }
+}
 
-    for (auto it = underConstruction.begin(); it != underConstruction.end();)
+template <typename Policy>
+void Plan::step(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented)
+{
+    uint64_t begin = instrumented ? Tracer::now() : 0;
+    if (status == PlanStatus::AVALIABLE)
     {
-        (*it)->step();
-        if ((*it)->getStatus() == FacilityStatus::OPERATIONAL)
+        // Policy is final, so these are direct calls
+        Policy &policy = static_cast<Policy &>(*selectionPolicy);
+        if (!policy.canSelect(facilityOptions))
         {
-            facilities.push_back(*it);
-            it = underConstruction.erase(it);
-
-            life_quality_score += (*it)->getLifeQualityScore();
-            economy_score += (*it)->getEconomyScore();
-            environment_score += (*it)->getEnvironmentScore();
+            // The plan stays available and builds nothing, the step reports it
+            if (counts.stalledSelections++ == 0 || plan_id < counts.firstStalledPlan)
+            {
+                counts.firstStalledPlan = plan_id;
+            }
         }
         else
         {
-            ++it;
+            while (underConstruction < constructionLimit)
+            {
+                size_t typeId = instrumented ? selectInstrumented(facilityOptions) : policy.selectFacility(facilityOptions);
+                building[underConstruction++] = Facility(typeId, facilityOptions[typeId].getCost());
+                ++counts.facilitiesStarted;
+            }
         }
     }
-    if (underConstruction.size() >= static_cast<unsigned int>(settlement.getType()))
+
+    // Finished facilities leave their slot, the others keep their order
+    size_t kept = 0;
+    for (size_t i = 0; i < underConstruction; ++i)
     {
-        status = PlanStatus::BUSY;
+        if (building[i].step() == FacilityStatus::OPERATIONAL)
+        {
+            size_t typeId = building[i].getTypeId();
+            completeFacility(typeId, facilityOptions[typeId]);
+            continue;
+        }
+        building[kept++] = building[i];
     }
-    else
+    counts.facilitiesCompleted += underConstruction - kept;
+    underConstruction = static_cast<unsigned char>(kept);
+    status = underConstruction >= constructionLimit ? PlanStatus::BUSY : PlanStatus::AVALIABLE;
+    if (instrumented && Tracer::isEnabled())
     {
-        status = PlanStatus::AVALIABLE;
+        Tracer::record("Plan::step", "plan", begin, Tracer::now());
     }
 }
 
-void Plan::printStatus()
+template void Plan::step<NaiveSelection>(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented);
+template void Plan::step<BalancedSelection>(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented);
+template void Plan::step<EconomySelection>(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented);
+template void Plan::step<SustainabilitySelection>(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented);
+
+size_t Plan::selectInstrumented(const FacilityCatalog &facilityOptions)
 {
-    cout << "PlanID: " << plan_id << std::endl;
-    cout << "SettlementName: " << settlement.getName() << std::endl;
-    cout << "PlanStatus: " << (status == PlanStatus::AVALIABLE ? "AVAILABLE" : "BUSY") << std::endl;
-    cout << "SelectionPolicy: " << selectionPolicy->toString() << std::endl;
-    cout << "LifeQualityScore: " << life_quality_score << std::endl;
-    cout << "EconomyScore: " << economy_score << std::endl;
-    cout << "EnvironmentScore: " << environment_score << std::endl;
-    for (Facility *facility : facilities)
+    TraceSpan span("SelectionPolicy::selectFacility", "plan");
+    ProfiledPhase phase(ProfilePhase::SELECTION);
+    return selectionPolicy->selectFacility(facilityOptions);
+}
+
+int Plan::stepsUntilEvent() const
+{
+    if (status == PlanStatus::AVALIABLE)
     {
-        cout << "FacilityName: " << facility->getName() << endl;
-        cout << "FacilityStatus: OPERATIONAL" << endl;
+        return 1;
     }
-    for (Facility *facility : underConstruction)
+    int steps = NoEvent;
+    for (size_t i = 0; i < underConstruction; ++i)
     {
-        cout << "FacilityName: " << facility->getName() << endl;
-        cout << "FacilityStatus: UNDER_CONSTRUCTIONS" << endl;
+        // A facility at 0 (only from a snapshot) finishes on the next step
+        int timeLeft = building[i].getTimeLeft();
+        int facilitySteps = timeLeft > 0 ? timeLeft : (timeLeft == 0 ? 1 : NoEvent);
+        steps = std::min(steps, facilitySteps);
     }
+    return steps;
 }
 
-const vector<Facility *> &Plan::getFacilities() const
+void Plan::fastForward(int steps)
 {
-    return facilities;
+    for (size_t i = 0; i < underConstruction; ++i)
+    {
+        building[i].advance(steps);
+    }
 }
 
-void Plan::addFacility(Facility *facility)
+void Plan::completeFacility(size_t typeId, const FacilityType &type)
 {
-    facilities.push_back(facility);
+    addOperational(static_cast<uint32_t>(typeId), 1);
+    life_quality_score += type.getLifeQualityScore();
+    economy_score += type.getEconomyScore();
+    environment_score += type.getEnvironmentScore();
+}
+
+void Plan::addOperational(uint32_t typeId, uint32_t count)
+{
+    if (!operationalRuns.empty() && operationalRuns.back().typeId == typeId)
+    {
+        operationalRuns.back().count += count;
+    }
+    else
+    {
+        operationalRuns.push_back(FacilityRun{typeId, count});
+    }
+}
+
+void Plan::printStatus(const FacilityCatalog &facilityOptions, bool summary) const
+{
+    cout << "PlanID: " << plan_id << '\n';
+    cout << "SettlementName: " << settlement.getName() << '\n';
+    cout << "PlanStatus: " << (status == PlanStatus::AVALIABLE ? "AVAILABLE" : "BUSY") << '\n';
+    cout << "SelectionPolicy: " << selectionPolicy->toString() << '\n';
+    cout << "LifeQualityScore: " << life_quality_score << '\n';
+    cout << "EconomyScore: " << economy_score << '\n';
+    cout << "EnvironmentScore: " << environment_score << '\n';
+    if (summary)
+    {
+        // Counted from the runs here, so plans do not keep a second copy
+        vector<FacilityRun> counts(operationalRuns);
+        std::sort(counts.begin(), counts.end(), [](const FacilityRun &a, const FacilityRun &b)
+                  { return a.typeId < b.typeId; });
+        size_t types = 0;
+        for (const FacilityRun &run : counts)
+        {
+            if (types > 0 && counts[types - 1].typeId == run.typeId)
+            {
+                counts[types - 1].count += run.count;
+            }
+            else
+            {
+                counts[types++] = run;
+            }
+        }
+        counts.resize(types);
+        for (const FacilityRun &counted : counts)
+        {
+            cout << "FacilityName: " << facilityOptions[counted.typeId].getName() << '\n';
+            cout << "FacilityStatus: OPERATIONAL\n";
+            cout << "FacilityCount: " << counted.count << '\n';
+        }
+    }
+    else
+    {
+        for (const FacilityRun &run : operationalRuns)
+        {
+            const string &name = facilityOptions[run.typeId].getName();
+            for (uint32_t i = 0; i < run.count; ++i)
+            {
+                cout << "FacilityName: " << name << '\n';
+                cout << "FacilityStatus: OPERATIONAL\n";
+            }
+        }
+    }
+    for (size_t i = 0; i < underConstruction; ++i)
+    {
+        cout << "FacilityName: " << facilityOptions[building[i].getTypeId()].getName() << '\n';
+        cout << "FacilityStatus: UNDER_CONSTRUCTIONS\n";
+    }
+}
+
+const vector<FacilityRun> &Plan::getOperationalRuns() const
+{
+    return operationalRuns;
 }
 
 const string Plan::toString() const
@@ -206,29 +299,102 @@ const Settlement Plan::getSettlement() const
     return settlement;
 }
 
-void Plan::copyFrom(const Plan &other)
+void Plan::saveState(SnapshotWriter &out) const
 {
-    for (const auto facility : other.facilities)
+    selectionPolicy->saveState(out);
+    out.writeUnsigned(status == PlanStatus::AVALIABLE ? 0 : 1);
+    out.writeSigned(life_quality_score);
+    out.writeSigned(economy_score);
+    out.writeSigned(environment_score);
+    out.writeUnsigned(operationalRuns.size());
+    for (const FacilityRun &run : operationalRuns)
     {
-        facilities.push_back(new Facility(*facility));
+        out.writeUnsigned(run.typeId);
+        out.writeUnsigned(run.count);
     }
-    for (const auto facility : other.underConstruction)
+    out.writeUnsigned(underConstruction);
+    for (size_t i = 0; i < underConstruction; ++i)
     {
-        underConstruction.push_back(new Facility(*facility));
+        out.writeUnsigned(building[i].getTypeId());
+        out.writeSigned(building[i].getTimeLeft());
     }
 }
 
+void Plan::loadState(SnapshotReader &in, const FacilityCatalog &facilityOptions)
+{
+    auto readFacilityType = [&in, &facilityOptions]() -> size_t
+    {
+        uint64_t index = in.readUnsigned();
+        if (index >= facilityOptions.size())
+        {
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        return static_cast<size_t>(index);
+    };
+
+    selectionPolicy->loadState(in);
+    status = in.readUnsigned() == 0 ? PlanStatus::AVALIABLE : PlanStatus::BUSY;
+    life_quality_score = in.readInt();
+    economy_score = in.readInt();
+    environment_score = in.readInt();
+    for (uint64_t runs = in.readUnsigned(); runs > 0; --runs)
+    {
+        size_t typeId = readFacilityType();
+        uint64_t count = in.readUnsigned();
+        if (count == 0 || count > UINT32_MAX)
+        {
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        addOperational(static_cast<uint32_t>(typeId), static_cast<uint32_t>(count));
+    }
+    uint64_t count = in.readUnsigned();
+    if (count > constructionLimit)
+    {
+        throw std::runtime_error("Snapshot is corrupted");
+    }
+    for (underConstruction = 0; underConstruction < count; ++underConstruction)
+    {
+        size_t typeId = readFacilityType();
+        building[underConstruction] = Facility(typeId, in.readInt());
+    }
+}
+
+void Plan::copyFrom(const Plan &other)
+{
+    // The settlement reference is bound on construction, both plans must share it
+    plan_id = other.plan_id;
+    selectionPolicy = other.selectionPolicy->clone();
+    policyKind = other.policyKind;
+    status = other.status;
+    constructionLimit = other.constructionLimit;
+    underConstruction = other.underConstruction;
+    life_quality_score = other.life_quality_score;
+    economy_score = other.economy_score;
+    environment_score = other.environment_score;
+    std::copy(other.building, other.building + MaxUnderConstruction, building);
+    operationalRuns = other.operationalRuns;
+}
+
 void Plan::moveFrom(Plan &&other) noexcept
 {
-    facilities = std::move(other.facilities);
-    underConstruction = std::move(other.underConstruction);
+    plan_id = other.plan_id;
+    selectionPolicy = other.selectionPolicy;
+    policyKind = other.policyKind;
+    status = other.status;
+    constructionLimit = other.constructionLimit;
+    underConstruction = other.underConstruction;
+    life_quality_score = other.life_quality_score;
+    economy_score = other.economy_score;
+    environment_score = other.environment_score;
+    std::copy(other.building, other.building + MaxUnderConstruction, building);
+    operationalRuns = std::move(other.operationalRuns);
 
     // Reset the other plan
     other.selectionPolicy = nullptr;
     other.status = PlanStatus::AVALIABLE;
+    other.underConstruction = 0;
     other.life_quality_score = 0;
     other.economy_score = 0;
     other.environment_score = 0;
-    other.facilities.clear();
-    other.underConstruction.clear();
-}
\ No newline at end of file
+    other.operationalRuns.clear();
+}
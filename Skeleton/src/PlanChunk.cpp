@@ -0,0 +1,97 @@
+#include "PlanChunk.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include <algorithm>
+
+PlanChunk::PlanChunk() : plans(), groups() {}
+
+void PlanChunk::reserve(size_t plans)
+{
+    this->plans.reserve(plans);
+}
+
+Plan &PlanChunk::addPlan(int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy)
+{
+    plans.emplace_back(planId, settlement, selectionPolicy);
+    groups[static_cast<size_t>(plans.back().getPolicyKind())].push_back(static_cast<uint32_t>(plans.size() - 1));
+    return plans.back();
+}
+
+void PlanChunk::setSelectionPolicy(size_t index, SelectionPolicy *selectionPolicy)
+{
+    Plan &plan = plans[index];
+    vector<uint32_t> &from = groups[static_cast<size_t>(plan.getPolicyKind())];
+    plan.setSelectionPolicy(selectionPolicy);
+    vector<uint32_t> &to = groups[static_cast<size_t>(plan.getPolicyKind())];
+    if (&from == &to)
+    {
+        return;
+    }
+    from.erase(std::lower_bound(from.begin(), from.end(), static_cast<uint32_t>(index)));
+    to.insert(std::lower_bound(to.begin(), to.end(), static_cast<uint32_t>(index)), static_cast<uint32_t>(index));
+}
+
+size_t PlanChunk::size() const
+{
+    return plans.size();
+}
+
+Plan &PlanChunk::operator[](size_t index)
+{
+    return plans[index];
+}
+
+const Plan &PlanChunk::operator[](size_t index) const
+{
+    return plans[index];
+}
+
+void PlanChunk::step(const FacilityCatalog &facilityOptions, StepCounts &counts)
+{
+    // Checked once, so plans pay nothing for tracing and profiling while they are off
+    bool instrumented = Tracer::isEnabled() || Profiler::isEnabled();
+    stepGroup<NaiveSelection>(facilityOptions, counts, instrumented);
+    stepGroup<BalancedSelection>(facilityOptions, counts, instrumented);
+    stepGroup<EconomySelection>(facilityOptions, counts, instrumented);
+    stepGroup<SustainabilitySelection>(facilityOptions, counts, instrumented);
+}
+
+template <typename Policy>
+void PlanChunk::stepGroup(const FacilityCatalog &facilityOptions, StepCounts &counts, bool instrumented)
+{
+    // Plain pointers, so the unoptimized build makes no call per plan to get there
+    Plan *chunk = plans.data();
+    const vector<uint32_t> &group = groups[static_cast<size_t>(Policy::Kind)];
+    const uint32_t *index = group.data();
+    const uint32_t *end = index + group.size();
+    for (; index != end; ++index)
+    {
+        chunk[*index].step<Policy>(facilityOptions, counts, instrumented);
+    }
+}
+
+int PlanChunk::stepsUntilEvent() const
+{
+    int steps = NoEvent;
+    for (const Plan &plan : plans)
+    {
+        steps = std::min(steps, plan.stepsUntilEvent());
+        if (steps == 1)
+        {
+            break;
+        }
+    }
+    return steps;
+}
+
+void PlanChunk::fastForward(int steps)
+{
+    if (steps <= 0)
+    {
+        return;
+    }
+    for (Plan &plan : plans)
+    {
+        plan.fastForward(steps);
+    }
+}
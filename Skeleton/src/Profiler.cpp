@@ -0,0 +1,381 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+static const int EventCount = ProfiledPhase::EventCount;
+static const size_t PhaseCount = static_cast<size_t>(ProfilePhase::NONE);
+
+struct CounterEvent
+{
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+};
+
+// The first event leads the group, the group is unusable without it
+static const CounterEvent events[EventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache_misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses"},
+};
+
+static const char *phaseNames[PhaseCount] = {"config_load", "step", "selection", "backup_restore", "output"};
+
+// One perf_event_open group, the members that could not be opened are left out
+class CounterGroup
+{
+public:
+    CounterGroup() : descriptors(), opened(0)
+    {
+        std::fill(descriptors, descriptors + EventCount, -1);
+    }
+
+    ~CounterGroup()
+    {
+        for (int descriptor : descriptors)
+        {
+            if (descriptor >= 0)
+            {
+                close(descriptor);
+            }
+        }
+    }
+
+    CounterGroup(const CounterGroup &other) = delete;
+    CounterGroup &operator=(const CounterGroup &other) = delete;
+
+    // Returns errno of the leader, 0 once it is open
+    int open(bool disabled)
+    {
+        for (int i = 0; i < EventCount; ++i)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = events[i].type;
+            attributes.config = events[i].config;
+            attributes.disabled = i == 0 && disabled ? 1 : 0;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            long descriptor = syscall(SYS_perf_event_open, &attributes, 0, -1, i == 0 ? -1 : descriptors[0], PERF_FLAG_FD_CLOEXEC);
+            if (descriptor < 0 && i == 0)
+            {
+                return errno;
+            }
+            descriptors[i] = static_cast<int>(descriptor);
+            opened += descriptor >= 0 ? 1 : 0;
+        }
+        return 0;
+    }
+
+    bool isOpen(int event) const
+    {
+        return descriptors[event] >= 0;
+    }
+
+    // Adds the counts so far, scaled up when the kernel had to multiplex the group
+    void addTo(uint64_t counts[EventCount]) const
+    {
+        if (descriptors[0] < 0)
+        {
+            return;
+        }
+        uint64_t values[3 + EventCount];
+        if (read(descriptors[0], values, sizeof(values)) < static_cast<ssize_t>((3 + opened) * sizeof(uint64_t)) || values[2] == 0)
+        {
+            return;
+        }
+        double scale = static_cast<double>(values[1]) / values[2];
+        int value = 3;
+        for (int i = 0; i < EventCount; ++i)
+        {
+            if (descriptors[i] >= 0)
+            {
+                counts[i] += static_cast<uint64_t>(values[value++] * scale);
+            }
+        }
+    }
+
+    void enable()
+    {
+        ioctl(descriptors[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void disable()
+    {
+        ioctl(descriptors[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void reset()
+    {
+        if (descriptors[0] >= 0)
+        {
+            ioctl(descriptors[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+private:
+    int descriptors[EventCount];
+    int opened;
+};
+
+struct ThreadCounters
+{
+    ThreadCounters() : phases(), selections(), selectionCount(0), selectionNanoseconds(0), selectionBegin(0) {}
+
+    CounterGroup phases;     // Always counting
+    CounterGroup selections; // Only counting inside a selection
+    uint64_t selectionCount;
+    uint64_t selectionNanoseconds;
+    int64_t selectionBegin;
+};
+
+struct PhaseTotals
+{
+    uint64_t runs;
+    uint64_t nanoseconds;
+    uint64_t counters[EventCount];
+};
+
+std::atomic<bool> Profiler::enabled(false);
+
+// Sessions are numbered, a thread that counted in an earlier one opens new groups
+static std::mutex registryLock;
+static std::vector<std::unique_ptr<ThreadCounters>> registry;
+static std::atomic<uint64_t> session(0);
+static bool hardware = false;      // The counters of the thread that started profiling opened
+static bool eventOpened[EventCount]; // Members of that group that opened
+static string unavailableReason;
+static PhaseTotals totals[PhaseCount];
+
+struct ThreadSlot
+{
+    ThreadCounters *counters;
+    uint64_t session;
+};
+
+static thread_local ThreadSlot slot = {nullptr, 0};
+
+static int64_t clockNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Registers the calling thread, registryLock must be held
+static ThreadCounters &attachLocked()
+{
+    uint64_t current = session.load(std::memory_order_acquire);
+    if (slot.counters == nullptr || slot.session != current)
+    {
+        registry.emplace_back(new ThreadCounters());
+        ThreadCounters &counters = *registry.back();
+        if (hardware)
+        {
+            counters.phases.open(false);
+            counters.selections.open(true);
+        }
+        slot.counters = &counters;
+        slot.session = current;
+    }
+    return *slot.counters;
+}
+
+static void readPhaseCounters(uint64_t counts[EventCount])
+{
+    std::fill(counts, counts + EventCount, 0);
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (const std::unique_ptr<ThreadCounters> &counters : registry)
+    {
+        counters->phases.addTo(counts);
+    }
+}
+
+// Selections counted so far, registryLock must be held
+static PhaseTotals selectionTotals()
+{
+    PhaseTotals selection = totals[static_cast<size_t>(ProfilePhase::SELECTION)];
+    for (const std::unique_ptr<ThreadCounters> &counters : registry)
+    {
+        selection.runs += counters->selectionCount;
+        selection.nanoseconds += counters->selectionNanoseconds;
+        counters->selections.addTo(selection.counters);
+    }
+    return selection;
+}
+
+void Profiler::start()
+{
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        if (enabled.load(std::memory_order_relaxed))
+        {
+            throw std::runtime_error("Profiling is already on");
+        }
+        registry.clear();
+        session.fetch_add(1, std::memory_order_release);
+
+        // Probe on this thread, the answer holds for the others
+        CounterGroup probe;
+        int error = probe.open(false);
+        hardware = error == 0;
+        unavailableReason = hardware ? "" : string("perf_event_open: ") + std::strerror(error);
+        for (int i = 0; i < EventCount; ++i)
+        {
+            eventOpened[i] = probe.isOpen(i);
+        }
+        enabled.store(true, std::memory_order_release);
+    }
+    attachThread();
+}
+
+void Profiler::stop()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (!enabled.load(std::memory_order_relaxed))
+    {
+        throw std::runtime_error("Profiling is not on");
+    }
+    enabled.store(false, std::memory_order_release);
+    totals[static_cast<size_t>(ProfilePhase::SELECTION)] = selectionTotals();
+    registry.clear();
+    session.fetch_add(1, std::memory_order_release);
+}
+
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    std::fill(totals, totals + PhaseCount, PhaseTotals());
+    for (const std::unique_ptr<ThreadCounters> &counters : registry)
+    {
+        counters->selections.reset();
+        counters->selectionCount = 0;
+        counters->selectionNanoseconds = 0;
+    }
+}
+
+void Profiler::attachThread()
+{
+    if (isEnabled() && (slot.counters == nullptr || slot.session != session.load(std::memory_order_acquire)))
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        attachLocked();
+    }
+}
+
+void Profiler::print(std::ostream &out)
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (!enabled.load(std::memory_order_relaxed) && session.load(std::memory_order_relaxed) == 0)
+    {
+        out << "Profiling is off, start it with: profile start" << '\n';
+        return;
+    }
+    if (!hardware)
+    {
+        out << "Hardware counters are unavailable (" << unavailableReason << "), phases are timed only" << '\n';
+    }
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::left << std::setw(16) << "phase" << std::right << std::setw(12) << "runs" << std::setw(14) << "seconds";
+    for (const CounterEvent &event : events)
+    {
+        out << std::setw(16) << event.name;
+    }
+    out << std::setw(8) << "ipc" << '\n';
+    for (size_t phase = 0; phase < PhaseCount; ++phase)
+    {
+        PhaseTotals phaseTotals = phase == static_cast<size_t>(ProfilePhase::SELECTION) ? selectionTotals() : totals[phase];
+        out << std::left << std::setw(16) << phaseNames[phase] << std::right << std::setw(12) << phaseTotals.runs
+            << std::fixed << std::setprecision(6) << std::setw(14) << phaseTotals.nanoseconds / 1e9;
+        for (int i = 0; i < EventCount; ++i)
+        {
+            if (hardware && eventOpened[i])
+            {
+                out << std::setw(16) << phaseTotals.counters[i];
+            }
+            else
+            {
+                out << std::setw(16) << "n/a";
+            }
+        }
+        uint64_t cycles = phaseTotals.counters[0];
+        if (hardware && eventOpened[1] && cycles > 0)
+        {
+            out << std::setprecision(2) << std::setw(8) << static_cast<double>(phaseTotals.counters[1]) / cycles;
+        }
+        else
+        {
+            out << std::setw(8) << "n/a";
+        }
+        out << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+ProfiledPhase::ProfiledPhase(ProfilePhase phase) : phase(ProfilePhase::NONE), session(0), begin(0), counters()
+{
+    if (phase == ProfilePhase::NONE || !Profiler::isEnabled())
+    {
+        return;
+    }
+    this->phase = phase;
+    session = ::session.load(std::memory_order_acquire);
+    if (phase == ProfilePhase::SELECTION)
+    {
+        Profiler::attachThread();
+        if (hardware)
+        {
+            slot.counters->selections.enable();
+        }
+        slot.counters->selectionBegin = clockNanoseconds();
+        return;
+    }
+    Profiler::attachThread();
+    readPhaseCounters(counters);
+    begin = clockNanoseconds();
+}
+
+ProfiledPhase::~ProfiledPhase()
+{
+    // Nothing is added if profiling stopped or restarted in between
+    if (phase == ProfilePhase::NONE || !Profiler::isEnabled() || session != ::session.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    if (phase == ProfilePhase::SELECTION)
+    {
+        if (hardware)
+        {
+            slot.counters->selections.disable();
+        }
+        ++slot.counters->selectionCount;
+        slot.counters->selectionNanoseconds += clockNanoseconds() - slot.counters->selectionBegin;
+        return;
+    }
+    int64_t end = clockNanoseconds();
+    uint64_t after[EventCount];
+    readPhaseCounters(after);
+    std::lock_guard<std::mutex> guard(registryLock);
+    PhaseTotals &phaseTotals = totals[static_cast<size_t>(phase)];
+    ++phaseTotals.runs;
+    phaseTotals.nanoseconds += static_cast<uint64_t>(end - begin);
+    for (int i = 0; i < EventCount; ++i)
+    {
+        phaseTotals.counters[i] += after[i] > counters[i] ? after[i] - counters[i] : 0;
+    }
+}
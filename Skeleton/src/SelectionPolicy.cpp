@@ -1,19 +1,29 @@
 #include "SelectionPolicy.h"
+#include "BalancedKernel.h"
+#include "Snapshot.h"
 #include <stdexcept>
-#include <limits>
-#include <algorithm>
 
 // NaiveSelection implementation
 NaiveSelection::NaiveSelection() : lastSelectedIndex(-1) {}
 
-const FacilityType &NaiveSelection::selectFacility(const vector<FacilityType> &facilitiesOptions)
+PolicyKind NaiveSelection::kind() const
+{
+    return Kind;
+}
+
+size_t NaiveSelection::selectFacility(const FacilityCatalog &facilitiesOptions)
 {
     if (facilitiesOptions.empty())
     {
         throw std::runtime_error("No facilities available for selection.");
     }
-    lastSelectedIndex++;
-    return facilitiesOptions[lastSelectedIndex];
+    lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
+    return lastSelectedIndex;
+}
+
+bool NaiveSelection::canSelect(const FacilityCatalog &facilitiesOptions) const
+{
+    return !facilitiesOptions.empty();
 }
 
 const string NaiveSelection::toString() const
@@ -26,39 +36,58 @@ NaiveSelection *NaiveSelection::clone() const
     return new NaiveSelection(*this);
 }
 
+void NaiveSelection::saveState(SnapshotWriter &out) const
+{
+    out.writeSigned(lastSelectedIndex);
+}
+
+void NaiveSelection::loadState(SnapshotReader &in)
+{
+    lastSelectedIndex = in.readInt();
+    if (lastSelectedIndex < -1)
+    {
+        throw std::runtime_error("Snapshot is corrupted");
+    }
+}
+
 // BalancedSelection implementation
 BalancedSelection::BalancedSelection(int lifeQualityScore, int economyScore, int environmentScore)
     : LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore) {}
 
-const FacilityType &BalancedSelection::selectFacility(const vector<FacilityType> &facilitiesOptions)
+PolicyKind BalancedSelection::kind() const
+{
+    return Kind;
+}
+
+size_t BalancedSelection::selectFacility(const FacilityCatalog &facilitiesOptions)
 {
     if (facilitiesOptions.empty())
     {
         throw std::runtime_error("No facilities available for selection.");
     }
 
-    int minDistance = std::numeric_limits<int>::max();
-    size_t selectedIndex = 0;
-
-    for (size_t i = 0; i < facilitiesOptions.size(); ++i)
+    // Only the score differences matter, so plans in the same state share a decision
+    BalancedDecisionCache &decisions = facilitiesOptions.getBalancedDecisions();
+    uint64_t key = BalancedDecisionCache::makeKey(LifeQualityScore, EconomyScore, EnvironmentScore);
+    size_t selectedIndex;
+    if (!decisions.find(key, selectedIndex))
     {
-        int life = facilitiesOptions[i].getLifeQualityScore() + LifeQualityScore;
-        int eco = facilitiesOptions[i].getEconomyScore() + EconomyScore;
-        int env = facilitiesOptions[i].getEnvironmentScore() + EnvironmentScore;
-        int distance = std::max({std::abs(life - eco), std::abs(life - env), std::abs(eco - env)});
-
-        if (distance < minDistance)
-        {
-            minDistance = distance;
-            selectedIndex = i;
-        }
+        selectedIndex = BalancedKernel::findMostBalanced(facilitiesOptions.getLifeQualityScores().data(), facilitiesOptions.getEconomyScores().data(),
+                                                         facilitiesOptions.getEnvironmentScores().data(), facilitiesOptions.size(),
+                                                         LifeQualityScore, EconomyScore, EnvironmentScore);
+        decisions.insert(key, selectedIndex);
     }
 
     LifeQualityScore = facilitiesOptions[selectedIndex].getLifeQualityScore() + LifeQualityScore;
     EconomyScore = facilitiesOptions[selectedIndex].getEconomyScore() + EconomyScore;
     EnvironmentScore = facilitiesOptions[selectedIndex].getEnvironmentScore() + EnvironmentScore;
 
-    return facilitiesOptions[selectedIndex];
+    return selectedIndex;
+}
+
+bool BalancedSelection::canSelect(const FacilityCatalog &facilitiesOptions) const
+{
+    return !facilitiesOptions.empty();
 }
 
 const string BalancedSelection::toString() const
@@ -71,22 +100,42 @@ BalancedSelection *BalancedSelection::clone() const
     return new BalancedSelection(*this);
 }
 
+void BalancedSelection::saveState(SnapshotWriter &out) const
+{
+    out.writeSigned(LifeQualityScore);
+    out.writeSigned(EconomyScore);
+    out.writeSigned(EnvironmentScore);
+}
+
+void BalancedSelection::loadState(SnapshotReader &in)
+{
+    LifeQualityScore = in.readInt();
+    EconomyScore = in.readInt();
+    EnvironmentScore = in.readInt();
+}
+
 // EconomySelection implementation
 EconomySelection::EconomySelection() : lastSelectedIndex(-1) {}
 
-const FacilityType &EconomySelection::selectFacility(const vector<FacilityType> &facilitiesOptions)
+PolicyKind EconomySelection::kind() const
 {
-    if (facilitiesOptions.empty())
-    {
-        throw std::runtime_error("No facilities available for selection.");
-    }
+    return Kind;
+}
 
-    do
+size_t EconomySelection::selectFacility(const FacilityCatalog &facilitiesOptions)
+{
+    const vector<size_t> &candidates = facilitiesOptions.getCategory(FacilityCategory::ECONOMY);
+    if (candidates.empty())
     {
-        lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
-    } while (facilitiesOptions[lastSelectedIndex].getCategory() != FacilityCategory::ECONOMY);
+        throw std::runtime_error("No economy facilities available for selection.");
+    }
+    lastSelectedIndex = (lastSelectedIndex + 1) % candidates.size();
+    return candidates[lastSelectedIndex];
+}
 
-    return facilitiesOptions[lastSelectedIndex];
+bool EconomySelection::canSelect(const FacilityCatalog &facilitiesOptions) const
+{
+    return !facilitiesOptions.getCategory(FacilityCategory::ECONOMY).empty();
 }
 
 const string EconomySelection::toString() const
@@ -99,21 +148,42 @@ EconomySelection *EconomySelection::clone() const
     return new EconomySelection(*this);
 }
 
+void EconomySelection::saveState(SnapshotWriter &out) const
+{
+    out.writeSigned(lastSelectedIndex);
+}
+
+void EconomySelection::loadState(SnapshotReader &in)
+{
+    lastSelectedIndex = in.readInt();
+    if (lastSelectedIndex < -1)
+    {
+        throw std::runtime_error("Snapshot is corrupted");
+    }
+}
+
 // SustainabilitySelection implementation
 SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(-1) {}
 
-const FacilityType &SustainabilitySelection::selectFacility(const vector<FacilityType> &facilitiesOptions)
+PolicyKind SustainabilitySelection::kind() const
 {
-    if (facilitiesOptions.empty())
+    return Kind;
+}
+
+size_t SustainabilitySelection::selectFacility(const FacilityCatalog &facilitiesOptions)
+{
+    const vector<size_t> &candidates = facilitiesOptions.getCategory(FacilityCategory::ENVIRONMENT);
+    if (candidates.empty())
     {
-        throw std::runtime_error("No facilities available for selection.");
+        throw std::runtime_error("No environment facilities available for selection.");
     }
-    do
-    {
-        lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
-    } while (facilitiesOptions[lastSelectedIndex].getCategory() != FacilityCategory::ENVIRONMENT);
+    lastSelectedIndex = (lastSelectedIndex + 1) % candidates.size();
+    return candidates[lastSelectedIndex];
+}
 
-    return facilitiesOptions[lastSelectedIndex];
+bool SustainabilitySelection::canSelect(const FacilityCatalog &facilitiesOptions) const
+{
+    return !facilitiesOptions.getCategory(FacilityCategory::ENVIRONMENT).empty();
 }
 
 const string SustainabilitySelection::toString() const
@@ -124,4 +194,18 @@ const string SustainabilitySelection::toString() const
 SustainabilitySelection *SustainabilitySelection::clone() const
 {
     return new SustainabilitySelection(*this);
+}
+
+void SustainabilitySelection::saveState(SnapshotWriter &out) const
+{
+    out.writeSigned(lastSelectedIndex);
+}
+
+void SustainabilitySelection::loadState(SnapshotReader &in)
+{
+    lastSelectedIndex = in.readInt();
+    if (lastSelectedIndex < -1)
+    {
+        throw std::runtime_error("Snapshot is corrupted");
+    }
 }
\ No newline at end of file
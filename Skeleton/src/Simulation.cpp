@@ -2,89 +2,34 @@
 #include "Action.h"
 #include "SelectionPolicy.h"
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
 #include "Auxiliary.h"
+#include "ConfigLoader.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+#include "Tracer.h"
 #include <utility>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
 
-Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0), actionsLog(),plans(),settlements(),facilitiesOptions()
+Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0), actionsLog(), plans(), settlements(), facilitiesOptions(), settlementsByName(), plansById(), planIdsBySettlement(), numThreads(1), pool(), commandArguments(), configLoadStats(), journal(), replaying(false), checkpointEvery(0), commandsSinceCheckpoint(0), stats(), chunkCounts()
 {
-    // Load configuration from file
-    std::ifstream configFile(configFilePath);
-    if (!configFile.is_open())
-    {
-        throw std::runtime_error("Could not open config file");
-    }
-
-    std::string line;
-    while (std::getline(configFile, line))
-    {
-        std::vector<std::string> parsedArguments = Auxiliary::parseArguments(line);
-        if (!parsedArguments.empty())
-        {
-            const std::string &command = parsedArguments[0];
-            if (command == "settlement")
-            {
-                if (parsedArguments.size() >= 3)
-                {
-                    std::string name = parsedArguments[1];
-                    SettlementType type = Auxiliary::parseSettlementType(parsedArguments[2]);
-
-                    Settlement *settlement = new Settlement(name, type);
-                    if (!addSettlement(settlement))
-                    {
-                        delete settlement;
-                        throw std::runtime_error("Settlement already exists");
-                    }
-                }
-            }
-            else if (command == "facility")
-            {
-                if (parsedArguments.size() >= 7)
-                {
-                    std::string name = parsedArguments[1];
-                    FacilityCategory category = Auxiliary::parseFacilityCategory(parsedArguments[2]);
-
-                    int price = std::stoi(parsedArguments[3]);
-                    int lifeQualityImpact = std::stoi(parsedArguments[4]);
-                    int ecoImpact = std::stoi(parsedArguments[5]);
-                    int envImpact = std::stoi(parsedArguments[6]);
-                    FacilityType facility(name, category, price, lifeQualityImpact, ecoImpact, envImpact);
-                    addFacility(facility);
-                }
-            }
-            else if (command == "plan")
-            {
-                if (parsedArguments.size() >= 3)
-                {
-                    addPlan(getSettlement(parsedArguments[1]), Auxiliary::createSelectionPolicy(parsedArguments[2]));
-                }
-            }
-        }
-    }
-
-    configFile.close();
+    configLoadStats = ConfigLoader(configFilePath).loadInto(*this);
 }
 
 // Destructor
 Simulation::~Simulation()
 {
-    for (auto action : actionsLog)
-    {
-        delete action;
-    }
-    actionsLog.clear();
-
-    for (auto settlement : settlements)
-    {
-        delete settlement;
-    }
-    settlements.clear();
+    // Everything is owned through shared pointers and is released with the last snapshot using it
 }
 
 // Copy constructor
-Simulation::Simulation(const Simulation &other)  : isRunning(false), planCounter(0), actionsLog(),plans(),settlements(),facilitiesOptions()
+Simulation::Simulation(const Simulation &other) : isRunning(false), planCounter(0), actionsLog(), plans(), settlements(), facilitiesOptions(), settlementsByName(), plansById(), planIdsBySettlement(), numThreads(1), pool(), commandArguments(), configLoadStats(), journal(), replaying(false), checkpointEvery(0), commandsSinceCheckpoint(0), stats(), chunkCounts()
 {
+    TraceSpan span("Simulation::Simulation(copy)", "backup");
     copyFrom(other);
 }
 
@@ -94,13 +39,14 @@ Simulation &Simulation::operator=(const Simulation &other)
     if (this != &other)
     {
         // Copy from other
+        TraceSpan span("Simulation::operator=(copy)", "backup");
         copyFrom(other);
     }
     return *this;
 }
 
 // Move constructor
-Simulation::Simulation(Simulation &&other) noexcept  : isRunning(false), planCounter(0), actionsLog(),plans(),settlements(),facilitiesOptions()
+Simulation::Simulation(Simulation &&other) noexcept : isRunning(false), planCounter(0), actionsLog(), plans(), settlements(), facilitiesOptions(), settlementsByName(), plansById(), planIdsBySettlement(), numThreads(1), pool(), commandArguments(), configLoadStats(), journal(), replaying(false), checkpointEvery(0), commandsSinceCheckpoint(0), stats(), chunkCounts()
 {
     moveFrom(std::move(other));
 }
@@ -110,17 +56,6 @@ Simulation &Simulation::operator=(Simulation &&other) noexcept
 {
     if (this != &other)
     {
-        // Clean up existing resources
-        for (auto action : actionsLog)
-        {
-            delete action;
-        }
-        actionsLog.clear();
-        for (auto settlement : settlements)
-        {
-            delete settlement;
-        }
-        settlements.clear();
         // Move from other
         moveFrom(std::move(other));
     }
@@ -132,96 +67,346 @@ void Simulation::start()
     isRunning = true;
     std::cout << "The simulation has started" << std::endl;
 
+    std::string line;
     while (isRunning)
     {
-        std::string line;
-        std::cout << "Enter a command: ";
-        std::getline(std::cin, line);
+        std::cout << "Enter a command: " << std::flush;
+        if (!std::getline(std::cin, line))
+        {
+            break;
+        }
+
+        processCommand(line);
+        std::cout.flush();
+    }
+}
+
+long Simulation::runScript(std::istream &input)
+{
+    // Output is only flushed on close and at the end, the caller picks the buffer size
+    isRunning = true;
+    std::cout << "The simulation has started\n";
 
+    long commands = 0;
+    std::string line; // Reused, so reading a line does not allocate once warm
+    while (isRunning && std::getline(input, line))
+    {
         processCommand(line);
+        ++commands;
     }
+    std::cout.flush();
+    return commands;
 }
 
+// Command table, indexed by CommandType. Each factory returns nullptr on malformed arguments.
+typedef BaseAction *(*ActionFactory)(const ArgumentList &arguments);
+
+struct CommandEntry
+{
+    size_t minArguments; // Including the command name
+    const char *usage;
+    ActionFactory create;
+};
+
+static BaseAction *createSimulateStep(const ArgumentList &arguments)
+{
+    int numOfSteps, numOfThreads;
+    if (!Auxiliary::parseInt(arguments[1], numOfSteps) || numOfSteps < 0)
+    {
+        return nullptr;
+    }
+    if (arguments.size() == 2)
+    {
+        return new SimulateStep(numOfSteps);
+    }
+    if (arguments.size() == 4 && arguments[2].equals("--threads") && Auxiliary::parseInt(arguments[3], numOfThreads) && numOfThreads > 0)
+    {
+        return new SimulateStep(numOfSteps, numOfThreads);
+    }
+    return nullptr;
+}
+
+static BaseAction *createAddPlan(const ArgumentList &arguments)
+{
+    return new AddPlan(arguments[1].toString(), arguments[2].toString());
+}
+
+static BaseAction *createAddSettlement(const ArgumentList &arguments)
+{
+    SettlementType type;
+    if (!Auxiliary::parseSettlementType(arguments[2], type))
+    {
+        return nullptr;
+    }
+    return new AddSettlement(arguments[1].toString(), type);
+}
+
+static BaseAction *createAddFacility(const ArgumentList &arguments)
+{
+    FacilityCategory category;
+    int price, lifeQualityScore, economyScore, environmentScore;
+    if (!Auxiliary::parseFacilityCategory(arguments[2], category) ||
+        !Auxiliary::parseInt(arguments[3], price) ||
+        !Auxiliary::parseInt(arguments[4], lifeQualityScore) ||
+        !Auxiliary::parseInt(arguments[5], economyScore) ||
+        !Auxiliary::parseInt(arguments[6], environmentScore))
+    {
+        return nullptr;
+    }
+    return new AddFacility(arguments[1].toString(), category, price, lifeQualityScore, economyScore, environmentScore);
+}
+
+static BaseAction *createPrintPlanStatus(const ArgumentList &arguments)
+{
+    int planId;
+    if (!Auxiliary::parseInt(arguments[1], planId))
+    {
+        return nullptr;
+    }
+    if (arguments.size() == 2)
+    {
+        return new PrintPlanStatus(planId);
+    }
+    if (arguments.size() == 3 && arguments[2].equals("--summary"))
+    {
+        return new PrintPlanStatus(planId, true);
+    }
+    return nullptr;
+}
+
+static BaseAction *createChangePlanPolicy(const ArgumentList &arguments)
+{
+    int planId;
+    if (!Auxiliary::parseInt(arguments[1], planId))
+    {
+        return nullptr;
+    }
+    return new ChangePlanPolicy(planId, arguments[2].toString());
+}
+
+static BaseAction *createPrintActionsLog(const ArgumentList &arguments)
+{
+    return new PrintActionsLog();
+}
+
+static BaseAction *createClose(const ArgumentList &arguments)
+{
+    return new Close();
+}
+
+static BaseAction *createBackupSimulation(const ArgumentList &arguments)
+{
+    return arguments.size() >= 2 ? new BackupSimulation(arguments[1].toString()) : new BackupSimulation();
+}
+
+static BaseAction *createRestoreSimulation(const ArgumentList &arguments)
+{
+    return arguments.size() >= 2 ? new RestoreSimulation(arguments[1].toString()) : new RestoreSimulation();
+}
+
+static BaseAction *createSaveSimulation(const ArgumentList &arguments)
+{
+    return new SaveSimulation(arguments[1].toString());
+}
+
+static BaseAction *createLoadSimulation(const ArgumentList &arguments)
+{
+    return new LoadSimulation(arguments[1].toString());
+}
+
+static BaseAction *createPrintStats(const ArgumentList &arguments)
+{
+    if (arguments.size() == 1)
+    {
+        return new PrintStats();
+    }
+    if (arguments.size() == 2 && arguments[1].equals("reset"))
+    {
+        return new PrintStats(true);
+    }
+    return nullptr;
+}
+
+static BaseAction *createTrace(const ArgumentList &arguments)
+{
+    if (arguments.size() == 2 && arguments[1].equals("start"))
+    {
+        return new Trace();
+    }
+    if (arguments.size() == 3 && arguments[1].equals("stop"))
+    {
+        return new Trace(arguments[2].toString());
+    }
+    return nullptr;
+}
+
+static BaseAction *createProfile(const ArgumentList &arguments)
+{
+    if (arguments.size() == 1)
+    {
+        return new Profile(Profile::Request::PRINT);
+    }
+    if (arguments.size() == 2 && arguments[1].equals("start"))
+    {
+        return new Profile(Profile::Request::START);
+    }
+    if (arguments.size() == 2 && arguments[1].equals("stop"))
+    {
+        return new Profile(Profile::Request::STOP);
+    }
+    if (arguments.size() == 2 && arguments[1].equals("reset"))
+    {
+        return new Profile(Profile::Request::RESET);
+    }
+    return nullptr;
+}
+
+static BaseAction *createAdvisePolicy(const ArgumentList &arguments)
+{
+    int planId, numOfSteps;
+    if (!Auxiliary::parseInt(arguments[1], planId) || !Auxiliary::parseInt(arguments[2], numOfSteps) || numOfSteps < 0)
+    {
+        return nullptr;
+    }
+    return new AdvisePolicy(planId, numOfSteps);
+}
+
+static const CommandEntry commandTable[] = {
+    {2, "step <number_of_steps> [--threads <count>]", createSimulateStep},
+    {3, "plan <settlement_name> <selection_policy>", createAddPlan},
+    {3, "settlement <settlement_name> <settlement_type>", createAddSettlement},
+    {7, "facility <facility_name> <category> <price> <lifeq_impact> <eco_impact> <env_impact>", createAddFacility},
+    {2, "planStatus <plan_id> [--summary]", createPrintPlanStatus},
+    {3, "changePolicy <plan_id> <selection_policy>", createChangePlanPolicy},
+    {1, "log", createPrintActionsLog},
+    {1, "close", createClose},
+    {1, "backup [name]", createBackupSimulation},
+    {1, "restore [name]", createRestoreSimulation},
+    {2, "save <file>", createSaveSimulation},
+    {2, "load <file>", createLoadSimulation},
+    {1, "stats [reset]", createPrintStats},
+    {2, "trace start | trace stop <file>", createTrace},
+    {1, "profile [start|stop|reset]", createProfile},
+    {3, "advise <plan_id> <number_of_steps>", createAdvisePolicy},
+};
+static_assert(sizeof(commandTable) / sizeof(commandTable[0]) == static_cast<size_t>(CommandType::UNKNOWN), "commandTable must cover every CommandType");
+
 void Simulation::processCommand(const std::string &line)
 {
-    std::vector<std::string> parsedArguments = Auxiliary::parseArguments(line);
-    if (!parsedArguments.empty())
+    commandArguments.parse(line);
+    if (commandArguments.empty())
     {
-        const std::string &command = parsedArguments[0];
-        if (command == "step")
-        {
-            BaseAction *action = new SimulateStep(std::stoi(parsedArguments[1]));
-            executeAction(action);
-        }
-        else if (command == "plan")
-        {
-            BaseAction *action = new AddPlan(parsedArguments[1], parsedArguments[2]);
-            executeAction(action);
-        }
-        else if (command == "settlement")
-        {
-            SettlementType type = Auxiliary::parseSettlementType(parsedArguments[2]);
-            BaseAction *action = new AddSettlement(parsedArguments[1], type);
-            executeAction(action);
-        }
-        else if (command == "facility")
-        {
-            FacilityCategory category = Auxiliary::parseFacilityCategory(parsedArguments[2]);
-            BaseAction *action = new AddFacility(parsedArguments[1], category, std::stoi(parsedArguments[3]), std::stoi(parsedArguments[4]), std::stoi(parsedArguments[5]), std::stoi(parsedArguments[6]));
-            executeAction(action);
-        }
-        else if (command == "planStatus")
-        {
-            BaseAction *action = new PrintPlanStatus(std::stoi(parsedArguments[1]));
-            executeAction(action);
-        }
-        else if (command == "changePolicy")
-        {
-            BaseAction *action = new ChangePlanPolicy(std::stoi(parsedArguments[1]), parsedArguments[2]);
-            executeAction(action);
-        }
-        else if (command == "log")
-        {
-            BaseAction *action = new PrintActionsLog();
-            executeAction(action);
-        }
-        else if (command == "close")
+        return;
+    }
+
+    CommandType type = Auxiliary::parseCommand(commandArguments[0]);
+    if (type == CommandType::UNKNOWN)
+    {
+        std::cerr << "Unknown command: ";
+        std::cerr.write(commandArguments[0].data, commandArguments[0].size) << std::endl;
+        return;
+    }
+
+    const CommandEntry &entry = commandTable[static_cast<size_t>(type)];
+    BaseAction *action = commandArguments.size() >= entry.minArguments ? entry.create(commandArguments) : nullptr;
+    if (action == nullptr)
+    {
+        std::cerr << "Error: Invalid arguments, usage: " << entry.usage << std::endl;
+        return;
+    }
+    if (journal == nullptr || replaying)
+    {
+        executeAction(action, type);
+        return;
+    }
+
+    // Journaled before it runs, a command the journal cannot hold is not run
+    if (type != CommandType::CLOSE)
+    {
+        try
         {
-            BaseAction *action = new Close();
-            executeAction(action);
+            journal->append(line);
         }
-        else if (command == "backup")
+        catch (const std::runtime_error &e)
         {
-            BaseAction *action = new BackupSimulation();
-            executeAction(action);
+            std::cerr << "Error: " << e.what() << std::endl;
+            delete action;
+            return;
         }
-        else if (command == "restore")
+    }
+    executeAction(action, type);
+    try
+    {
+        if (type == CommandType::CLOSE)
         {
-            BaseAction *action = new RestoreSimulation();
-            executeAction(action);
+            journal->discard();
         }
-        else
+        else if (type == CommandType::LOAD || (checkpointEvery > 0 && ++commandsSinceCheckpoint >= checkpointEvery))
         {
-            std::cerr << "Unknown command: " << command << std::endl;
+            // A replayed load would read the file as it is then, so its result is kept instead
+            checkpoint();
         }
     }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
 }
 
-void Simulation::executeAction(BaseAction *action)
+// The profiler phase a command runs in, steps are counted here and not in fastForward
+static ProfilePhase profilePhaseOf(CommandType type)
 {
+    switch (type)
+    {
+    case CommandType::STEP:
+        return ProfilePhase::STEP;
+    case CommandType::BACKUP:
+    case CommandType::RESTORE:
+        return ProfilePhase::BACKUP_RESTORE;
+    case CommandType::PLAN_STATUS:
+    case CommandType::ADVISE:
+    case CommandType::LOG:
+    case CommandType::STATS:
+        return ProfilePhase::OUTPUT;
+    default:
+        return ProfilePhase::NONE;
+    }
+}
+
+void Simulation::executeAction(BaseAction *action, CommandType type)
+{
+    TraceSpan span(Auxiliary::commandName(type), "command");
+    ProfiledPhase phase(profilePhaseOf(type));
+    auto begin = std::chrono::steady_clock::now();
     action->act(*this);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    stats.recordCommand(type, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
     addAction(action);
 }
 
 void Simulation::addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy)
 {
     // Create a plan with the given settlement and selection policy and add it to the plans vector.
-    plans.emplace_back(planCounter++, settlement, selectionPolicy, facilitiesOptions);
+    size_t index = getPlanCount();
+    vector<CowPtr<PlanChunk>> &chunks = plans.mut();
+    if (index % PlanChunkSize == 0)
+    {
+        chunks.push_back(CowPtr<PlanChunk>());
+        chunks.back().mut().reserve(PlanChunkSize);
+    }
+    plansById.mut()[planCounter] = index;
+    planIdsBySettlement.mut()[settlement.getName()].push_back(planCounter);
+    chunks.back().mut().addPlan(planCounter++, settlement, selectionPolicy);
 }
 
 void Simulation::addAction(BaseAction *action)
 {
-    actionsLog.push_back(action);
+    // The action writes its own fields, so no line is formatted for the log
+    ActionLog &log = actionsLog.mut();
+    log.beginEntry();
+    action->appendTo(log);
+    log.endEntry(action->getStatus());
+    delete action;
 }
 
 bool Simulation::addSettlement(Settlement *settlement)
@@ -230,78 +415,208 @@ bool Simulation::addSettlement(Settlement *settlement)
     {
         return false;
     }
-    settlements.push_back(settlement);
+    settlements.mut().push_back(std::shared_ptr<Settlement>(settlement, std::default_delete<Settlement>(), PoolAllocator<Settlement>()));
+    settlementsByName.mut()[settlement->getName()] = settlement;
     return true;
 }
 
-bool Simulation::addFacility(FacilityType facility)
+bool Simulation::addFacility(const FacilityType &facility)
 {
-    for (FacilityType current_facility : facilitiesOptions)
+    if (facilitiesOptions->contains(facility.getName()))
     {
-        if (current_facility.getName() == facility.getName())
-        {
-            throw std::runtime_error("Facility already exists");
-        }
+        throw std::runtime_error("Facility already exists");
     }
-    facilitiesOptions.push_back(facility);
-    return true;
+    return facilitiesOptions.mut().add(facility);
 }
 
 bool Simulation::isSettlementExists(const string &settlementName)
 {
-    for (const auto &settlement : settlements)
-    {
-        if (settlement->getName() == settlementName)
-        {
-            return true;
-        }
-    }
-    return false;
+    return settlementsByName->count(settlementName) != 0;
 }
 
 Settlement &Simulation::getSettlement(const string &settlementName)
 {
-    for (auto &settlement : settlements)
+    auto found = settlementsByName->find(settlementName);
+    if (found == settlementsByName->end())
     {
-        if (settlement->getName() == settlementName)
-        {
-            return *settlement;
-        }
+        throw std::runtime_error("Settlement not found");
     }
-    throw std::runtime_error("Settlement not found");
+    return *found->second;
 }
 
 Plan &Simulation::getPlan(const int planID)
 {
-    for (auto &plan : plans)
+    auto found = plansById->find(planID);
+    if (found == plansById->end())
+    {
+        throw std::runtime_error("Plan not found");
+    }
+    return planAt(found->second);
+}
+
+const Plan &Simulation::getPlan(const int planID) const
+{
+    auto found = plansById->find(planID);
+    if (found == plansById->end())
     {
-        if (plan.getId() == planID)
+        throw std::runtime_error("Plan not found");
+    }
+    return planAt(found->second);
+}
+
+void Simulation::setPlanPolicy(const int planID, SelectionPolicy *selectionPolicy)
+{
+    auto found = plansById->find(planID);
+    if (found == plansById->end())
+    {
+        delete selectionPolicy;
+        throw std::runtime_error("Plan not found");
+    }
+    // Through the chunk, which keeps its plans grouped by policy
+    plans.mut()[found->second / PlanChunkSize].mut().setSelectionPolicy(found->second % PlanChunkSize, selectionPolicy);
+}
+
+void Simulation::printPlanStatus(const int planID, bool summary) const
+{
+    auto found = plansById->find(planID);
+    if (found == plansById->end())
+    {
+        throw std::runtime_error("Plan not found");
+    }
+    if (!replaying)
+    {
+        planAt(found->second).printStatus(*facilitiesOptions, summary);
+    }
+}
+
+const vector<int> &Simulation::getPlanIds(const string &settlementName) const
+{
+    static const vector<int> noPlans;
+    auto found = planIdsBySettlement->find(settlementName);
+    return found == planIdsBySettlement->end() ? noPlans : found->second;
+}
+
+void Simulation::step()
+{
+    step(numThreads);
+}
+
+void Simulation::step(int numThreads)
+{
+    fastForward(1, numThreads);
+}
+
+// Steps a plan or a chunk of them numOfSteps times. Between two events nothing
+// is selected or completed, so those steps are counted down in one go.
+template <typename Plans>
+static void runSteps(Plans &plans, const FacilityCatalog &facilities, int numOfSteps, StepCounts &counts)
+{
+    long long done = 0;
+    while (done < numOfSteps)
+    {
+        int untilEvent = plans.stepsUntilEvent();
+        if (untilEvent == Plan::NoEvent || done + untilEvent > numOfSteps)
         {
-            return plan;
+            plans.fastForward(static_cast<int>(numOfSteps - done));
+            break;
         }
+        plans.fastForward(untilEvent - 1);
+        plans.step(facilities, counts);
+        done += untilEvent;
     }
-    throw std::runtime_error("Plan not found");
 }
 
-void Simulation::step()
+void Simulation::fastForward(int numOfSteps, int numThreads)
 {
     if (!isRunning)
     {
         throw std::runtime_error("Simulation is not running");
     }
+    TraceSpan span("Simulation::step", "step"); // Every step runs through here
+    if (numOfSteps <= 0)
+    {
+        return;
+    }
+
+    // Chunks never interact, so each one runs all the steps on its own
+    detachPlans();
+    const FacilityCatalog &facilities = *facilitiesOptions;
+    vector<CowPtr<PlanChunk>> &chunks = plans.mut();
+    if (chunkCounts.size() < chunks.size())
+    {
+        chunkCounts.resize(chunks.size());
+    }
+    auto runChunk = [this, &chunks, &facilities, numOfSteps](size_t i)
+    {
+        TraceSpan span("PlanChunk steps", "step");
+        chunkCounts[i] = StepCounts();
+        runSteps(chunks[i].mut(), facilities, numOfSteps, chunkCounts[i]);
+    };
+    if (numThreads > 1 && chunks.size() > 1)
+    {
+        getPool(numThreads).parallelFor(chunks.size(), runChunk);
+    }
+    else
+    {
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            runChunk(i);
+        }
+    }
+    int stalledPlan = -1;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        const StepCounts &counts = chunkCounts[i];
+        stats.addSteps(counts);
+        if (counts.stalledSelections > 0 && (stalledPlan < 0 || counts.firstStalledPlan < stalledPlan))
+        {
+            stalledPlan = counts.firstStalledPlan;
+        }
+    }
+    if (stalledPlan >= 0)
+    {
+        // The other plans have stepped, this one stayed available without building
+        const SelectionPolicy *policy = getPlan(stalledPlan).getSelectionPolicy();
+        throw std::runtime_error("Plan " + std::to_string(stalledPlan) + " has no facility to select with policy " + policy->toString());
+    }
+}
 
-    for (auto &plan : plans)
+void Simulation::setThreads(int numThreads)
+{
+    if (numThreads < 1)
     {
-        plan.step();
+        throw std::invalid_argument("Thread count must be positive");
     }
+    this->numThreads = numThreads;
+}
+
+int Simulation::getThreads() const
+{
+    return numThreads;
+}
+
+const ConfigLoadStats &Simulation::getConfigLoadStats() const
+{
+    return configLoadStats;
+}
+
+const FacilityCatalog &Simulation::getFacilityCatalog() const
+{
+    return *facilitiesOptions;
+}
+
+BalancedDecisionCache::Stats Simulation::getBalancedDecisionStats() const
+{
+    return facilitiesOptions->getBalancedDecisions().getStats();
 }
 
 void Simulation::close()
 {
-    for (const auto &plan : plans)
+    for (size_t i = 0; i < getPlanCount(); ++i)
     {
-        std::cout << plan.toString() << std::endl;
+        std::cout << planAt(i).toString() << '\n';
     }
+    std::cout.flush();
     isRunning = false;
 }
 
@@ -310,64 +625,413 @@ void Simulation::open()
     isRunning = true;
 }
 
-vector<BaseAction *> Simulation::getActionsLog()
+const ActionLog &Simulation::getActionsLog() const
 {
-    return actionsLog;
+    return *actionsLog;
 }
 
-void Simulation::copyFrom(const Simulation &other)
+static void writeSnapshotHeader(SnapshotWriter &out)
+{
+    out.writeRaw(SnapshotMagic, sizeof(SnapshotMagic));
+    out.writeUnsigned(SnapshotVersion);
+}
+
+static void readSnapshotHeader(SnapshotReader &in)
 {
-    // Clear existing data
-    for (auto action : actionsLog)
+    char magic[sizeof(SnapshotMagic)];
+    in.readRaw(magic, sizeof(magic));
+    if (!std::equal(magic, magic + sizeof(magic), SnapshotMagic))
+    {
+        throw std::runtime_error("Not a snapshot file");
+    }
+    if (in.readUnsigned() != SnapshotVersion)
     {
-        delete action;
+        throw std::runtime_error("Unsupported snapshot version");
     }
-    actionsLog.clear();
+}
+
+void Simulation::save(const string &path) const
+{
+    SnapshotWriter out;
+    writeSnapshotHeader(out);
+    writeState(out);
+    out.saveToFile(path);
+}
 
-    for (auto settlement : settlements)
+void Simulation::load(const string &path)
+{
+    MappedFile file(path);
+    SnapshotReader in(file.data(), file.size());
+    readSnapshotHeader(in);
+    readState(in);
+    if (!in.atEnd())
     {
-        delete settlement;
+        throw std::runtime_error("Snapshot is corrupted");
     }
-    settlements.clear();
+}
 
-    plans.clear();
-    facilitiesOptions.clear();
+uint64_t Simulation::openJournal(const string &path, size_t checkpointEvery)
+{
+    std::unique_ptr<Journal> opened(new Journal(path));
+    open();
+    uint64_t sequence = 0;
+    if (std::ifstream(opened->getCheckpointPath()).good())
+    {
+        sequence = loadCheckpoint(opened->getCheckpointPath());
+    }
 
-    // Copy data from the other object
-    isRunning = other.isRunning;
-    planCounter = other.planCounter;
-    for (const auto action : other.actionsLog)
+    // The output was seen when the commands first ran. Printing commands skip
+    // their work while replaying, anything else written is thrown away.
+    struct Silence
+    {
+        Simulation &simulation;
+        std::streambuf *out;
+        std::streambuf *err;
+        Silence(Simulation &simulation) : simulation(simulation), out(std::cout.rdbuf(nullptr)), err(std::cerr.rdbuf(nullptr))
+        {
+            simulation.replaying = true;
+        }
+        Silence(const Silence &other) = delete;
+        Silence &operator=(const Silence &other) = delete;
+        ~Silence()
+        {
+            simulation.replaying = false;
+            std::cout.rdbuf(out);
+            std::cout.clear();
+            std::cerr.rdbuf(err);
+            std::cerr.clear();
+        }
+    };
+    uint64_t replayed;
+    {
+        Silence silence(*this);
+        replayed = opened->replay(sequence, [this](const string &command)
+                                  { processCommand(command); });
+    }
+    journal = std::move(opened);
+    stats.reset(); // Replayed commands are not what this session's console did
+    this->checkpointEvery = checkpointEvery;
+    commandsSinceCheckpoint = 0;
+    return replayed;
+}
+
+void Simulation::checkpoint()
+{
+    if (journal == nullptr)
+    {
+        throw std::runtime_error("No journal to checkpoint");
+    }
+    SnapshotWriter out;
+    writeSnapshotHeader(out);
+    out.writeUnsigned(journal->getNextSequence());
+    writeState(out);
+    out.writeUnsigned(backups.size());
+    for (const auto &backup : backups)
+    {
+        out.writeString(backup.first);
+        backup.second.writeState(out);
+    }
+    journal->checkpoint(out);
+    commandsSinceCheckpoint = 0;
+}
+
+const SimulationStats &Simulation::getStats() const
+{
+    return stats;
+}
+
+void Simulation::resetStats()
+{
+    stats.reset();
+}
+
+const Journal *Simulation::getJournal() const
+{
+    return journal.get();
+}
+
+bool Simulation::isReplaying() const
+{
+    return replaying;
+}
+
+uint64_t Simulation::loadCheckpoint(const string &path)
+{
+    MappedFile file(path);
+    SnapshotReader in(file.data(), file.size());
+    readSnapshotHeader(in);
+    uint64_t sequence = in.readUnsigned();
+    readState(in);
+    std::map<string, Simulation> restored;
+    for (uint64_t count = in.readUnsigned(); count > 0; --count)
+    {
+        string name = in.readString();
+        Simulation backup(*this);
+        backup.readState(in);
+        restored.emplace(name, std::move(backup));
+    }
+    if (!in.atEnd())
+    {
+        throw std::runtime_error("Checkpoint is corrupted");
+    }
+    backups = std::move(restored);
+    return sequence;
+}
+
+void Simulation::writeState(SnapshotWriter &out) const
+{
+    out.writeSigned(planCounter);
+    out.writeSigned(numThreads);
+
+    std::unordered_map<string, size_t> settlementIndexes;
+    out.writeUnsigned(settlements->size());
+    for (const auto &settlement : *settlements)
+    {
+        size_t index = settlementIndexes.size();
+        settlementIndexes[settlement->getName()] = index;
+        out.writeString(settlement->getName());
+        out.writeUnsigned(static_cast<unsigned int>(settlement->getType()));
+    }
+
+    out.writeUnsigned(facilitiesOptions->size());
+    for (const auto &facility : facilitiesOptions->getFacilities())
+    {
+        out.writeString(facility.getName());
+        out.writeUnsigned(static_cast<unsigned int>(facility.getCategory()));
+        out.writeSigned(facility.getCost());
+        out.writeSigned(facility.getLifeQualityScore());
+        out.writeSigned(facility.getEconomyScore());
+        out.writeSigned(facility.getEnvironmentScore());
+    }
+
+    out.writeUnsigned(getPlanCount());
+    for (size_t i = 0; i < getPlanCount(); ++i)
+    {
+        const Plan &plan = planAt(i);
+        out.writeSigned(plan.getId());
+        out.writeUnsigned(settlementIndexes.at(plan.getSettlement().getName()));
+        out.writeString(plan.getSelectionPolicy()->toString());
+        plan.saveState(out);
+    }
+
+    // Actions are kept as their log line, split before the status
+    out.writeUnsigned(actionsLog->size());
+    actionsLog->forEach([&out](const string &command, ActionStatus status)
+                        {
+                            out.writeString(command);
+                            out.writeUnsigned(status == ActionStatus::COMPLETED ? 0 : 1);
+                        });
+}
+
+void Simulation::readState(SnapshotReader &in)
+{
+    // Build into a fresh simulation so a bad file leaves this one untouched
+    Simulation loaded(*this);
+    loaded.clear();
+    int savedPlanCounter = in.readInt();
+    loaded.numThreads = std::max(1, in.readInt());
+
+    vector<Settlement *> settlementsByIndex;
+    for (uint64_t count = in.readUnsigned(); count > 0; --count)
+    {
+        string name = in.readString();
+        uint64_t type = in.readUnsigned();
+        if (type < 1 || type > 3)
+        {
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        Settlement *settlement = new Settlement(name, static_cast<SettlementType>(type));
+        if (!loaded.addSettlement(settlement))
+        {
+            delete settlement;
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        settlementsByIndex.push_back(settlement);
+    }
+
+    for (uint64_t count = in.readUnsigned(); count > 0; --count)
+    {
+        string name = in.readString();
+        uint64_t category = in.readUnsigned();
+        if (category > 2)
+        {
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        int price = in.readInt();
+        int lifeQualityScore = in.readInt();
+        int economyScore = in.readInt();
+        int environmentScore = in.readInt();
+        loaded.addFacility(FacilityType(name, static_cast<FacilityCategory>(category), price, lifeQualityScore, economyScore, environmentScore));
+    }
+
+    for (uint64_t count = in.readUnsigned(); count > 0; --count)
+    {
+        int planId = in.readInt();
+        uint64_t settlementIndex = in.readUnsigned();
+        if (planId != loaded.planCounter || settlementIndex >= settlementsByIndex.size())
+        {
+            throw std::runtime_error("Snapshot is corrupted");
+        }
+        loaded.addPlan(*settlementsByIndex[settlementIndex], Auxiliary::createSelectionPolicy(in.readString()));
+        loaded.getPlan(planId).loadState(in, *loaded.facilitiesOptions);
+    }
+    loaded.planCounter = savedPlanCounter;
+
+    for (uint64_t count = in.readUnsigned(); count > 0; --count)
+    {
+        string command = in.readString();
+        ActionStatus status = in.readUnsigned() == 0 ? ActionStatus::COMPLETED : ActionStatus::ERROR;
+        loaded.actionsLog.mut().append(command, status);
+    }
+
+    bool wasRunning = isRunning;
+    *this = std::move(loaded);
+    isRunning = wasRunning;
+}
+
+size_t Simulation::getPlanCount() const
+{
+    return plansById->size();
+}
+
+ScoreTotals Simulation::getScoreTotals() const
+{
+    ScoreTotals totals = ScoreTotals();
+    for (size_t i = 0; i < getPlanCount(); ++i)
     {
-        actionsLog.push_back(action->clone());
+        const Plan &plan = planAt(i);
+        totals.lifeQualityScore += plan.getlifeQualityScore();
+        totals.economyScore += plan.getEconomyScore();
+        totals.environmentScore += plan.getEnvironmentScore();
     }
-    for (const auto settlement : other.settlements)
+    return totals;
+}
+
+void Simulation::setSelectionPolicies(const string &policy)
+{
+    delete Auxiliary::createSelectionPolicy(policy); // Throws before any plan changes
+    for (CowPtr<PlanChunk> &chunk : plans.mut())
     {
-        settlements.push_back(new Settlement(*settlement));
+        PlanChunk &plansInChunk = chunk.mut();
+        for (size_t i = 0; i < plansInChunk.size(); ++i)
+        {
+            plansInChunk.setSelectionPolicy(i, Auxiliary::createSelectionPolicy(policy));
+        }
+    }
+}
+
+void Simulation::useFacilitiesOf(const Simulation &other)
+{
+    // Plans refer to facilities by catalog position, so this is only safe before any was selected
+    facilitiesOptions = other.facilitiesOptions;
+}
+
+vector<PolicyProjection> Simulation::advise(int planId, int numOfSteps)
+{
+    const Simulation &self = *this; // The const lookup leaves the plan's chunk shared
+    const Plan &plan = self.getPlan(planId);
+    const FacilityCatalog &facilities = *facilitiesOptions;
+    const string current = plan.getSelectionPolicy()->toString();
+    const char *candidates[] = {"nve", "bal", "eco", "env"};
+    const size_t candidateCount = sizeof(candidates) / sizeof(candidates[0]);
+    vector<PolicyProjection> projections(candidateCount, PolicyProjection{string(), false, false, ScoreTotals()});
+    auto project = [&](size_t i)
+    {
+        // Only the plan is copied, its facilities and timers included
+        Plan projected = current == candidates[i] ? Plan(plan) : Plan(plan, Auxiliary::createSelectionPolicy(candidates[i]));
+        PolicyProjection &projection = projections[i];
+        projection.policy = candidates[i];
+        projection.current = current == candidates[i];
+        projection.selectable = projected.getSelectionPolicy()->canSelect(facilities);
+        if (projection.selectable)
+        {
+            StepCounts counts = StepCounts();
+            runSteps(projected, facilities, numOfSteps, counts);
+        }
+        projection.scores = ScoreTotals{projected.getlifeQualityScore(), projected.getEconomyScore(), projected.getEnvironmentScore()};
+    };
+    if (numThreads > 1)
+    {
+        getPool(numThreads).parallelFor(candidateCount, project);
+    }
+    else
+    {
+        for (size_t i = 0; i < candidateCount; ++i)
+        {
+            project(i);
+        }
     }
-    for (const auto &facility : other.facilitiesOptions)
+    return projections;
+}
+
+const Plan &Simulation::planAt(size_t index) const
+{
+    return (*(*plans)[index / PlanChunkSize])[index % PlanChunkSize];
+}
+
+Plan &Simulation::planAt(size_t index)
+{
+    return plans.mut()[index / PlanChunkSize].mut()[index % PlanChunkSize];
+}
+
+void Simulation::detachPlans()
+{
+    for (CowPtr<PlanChunk> &chunk : plans.mut())
     {
-        facilitiesOptions.push_back(facility);
+        chunk.mut();
     }
-    for (const auto &plan : other.plans)
+}
+
+WorkStealingPool &Simulation::getPool(int numThreads)
+{
+    if (!pool || pool->size() != numThreads)
     {
-        plans.push_back(Plan(plan, getSettlement(plan.getSettlement().getName()), facilitiesOptions));
+        pool.reset(new WorkStealingPool(numThreads));
     }
+    return *pool;
+}
+
+void Simulation::copyFrom(const Simulation &other)
+{
+    // Share everything, the first change on either side copies the part it touches
+    isRunning = other.isRunning;
+    planCounter = other.planCounter;
+    numThreads = other.numThreads;
+    actionsLog = other.actionsLog;
+    plans = other.plans;
+    settlements = other.settlements;
+    facilitiesOptions = other.facilitiesOptions;
+    settlementsByName = other.settlementsByName;
+    plansById = other.plansById;
+    planIdsBySettlement = other.planIdsBySettlement;
+}
+
+void Simulation::clear()
+{
+    planCounter = 0;
+    actionsLog = CowPtr<ActionLog>();
+    plans = CowPtr<vector<CowPtr<PlanChunk>>>();
+    settlements = CowPtr<vector<std::shared_ptr<Settlement>>>();
+    facilitiesOptions = CowPtr<FacilityCatalog>();
+    settlementsByName = CowPtr<std::unordered_map<string, Settlement *>>();
+    plansById = CowPtr<std::unordered_map<int, size_t>>();
+    planIdsBySettlement = CowPtr<std::unordered_map<string, vector<int>>>();
 }
 
 void Simulation::moveFrom(Simulation &&other) noexcept
 {
     isRunning = other.isRunning;
     planCounter = other.planCounter;
+    numThreads = other.numThreads;
     actionsLog = std::move(other.actionsLog);
-    settlements = std::move(other.settlements);
     plans = std::move(other.plans);
+    settlements = std::move(other.settlements);
     facilitiesOptions = std::move(other.facilitiesOptions);
+    settlementsByName = std::move(other.settlementsByName);
+    plansById = std::move(other.plansById);
+    planIdsBySettlement = std::move(other.planIdsBySettlement);
 
     // Reset the other simulation
     other.isRunning = false;
-    other.planCounter = 0;
-    other.actionsLog.clear();
-    other.settlements.clear();
-    other.plans.clear();
-    other.facilitiesOptions.clear();
+    other.clear();
 }
@@ -0,0 +1,73 @@
+#include "SimulationStats.h"
+#include "ObjectPool.h"
+#include <iomanip>
+
+SimulationStats::SimulationStats()
+    : latencies(static_cast<size_t>(CommandType::UNKNOWN)), steps(), allocationsAtReset(ObjectPool::getStats().allocations) {}
+
+void SimulationStats::recordCommand(CommandType type, uint64_t nanoseconds)
+{
+    latencies[static_cast<size_t>(type)].record(nanoseconds);
+}
+
+void SimulationStats::addSteps(const StepCounts &counts)
+{
+    steps.facilitiesStarted += counts.facilitiesStarted;
+    steps.facilitiesCompleted += counts.facilitiesCompleted;
+}
+
+void SimulationStats::reset()
+{
+    for (LatencyHistogram &latency : latencies)
+    {
+        latency.reset();
+    }
+    steps = StepCounts();
+    allocationsAtReset = ObjectPool::getStats().allocations;
+}
+
+const LatencyHistogram &SimulationStats::getLatency(CommandType type) const
+{
+    return latencies[static_cast<size_t>(type)];
+}
+
+const StepCounts &SimulationStats::getStepCounts() const
+{
+    return steps;
+}
+
+uint64_t SimulationStats::getAllocations() const
+{
+    return ObjectPool::getStats().allocations - allocationsAtReset;
+}
+
+void SimulationStats::print(std::ostream &out) const
+{
+    // Latencies in microseconds, only for commands that ran
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+    out << std::left << std::setw(14) << "command" << std::right << std::setw(10) << "count" << std::setw(12) << "mean_us" << std::setw(12) << "p50_us"
+        << std::setw(12) << "p90_us" << std::setw(12) << "p99_us" << std::setw(12) << "p99.9_us" << std::setw(12) << "max_us" << '\n';
+    for (size_t type = 0; type < latencies.size(); ++type)
+    {
+        const LatencyHistogram &latency = latencies[type];
+        if (latency.getCount() == 0)
+        {
+            continue;
+        }
+        out << std::left << std::setw(14) << Auxiliary::commandName(static_cast<CommandType>(type)) << std::right << std::setw(10) << latency.getCount()
+            << std::setw(12) << latency.getMean() / 1000;
+        for (double percentile : {50.0, 90.0, 99.0, 99.9})
+        {
+            out << std::setw(12) << latency.getValueAtPercentile(percentile) / 1000.0;
+        }
+        out << std::setw(12) << latency.getMax() / 1000.0 << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+    out << "Facilities started: " << steps.facilitiesStarted << '\n';
+    out << "Facilities completed: " << steps.facilitiesCompleted << '\n';
+    out << "Selections: " << steps.facilitiesStarted << '\n';
+    out << "Allocations: " << getAllocations() << '\n';
+}
@@ -0,0 +1,221 @@
+#include "Snapshot.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// SnapshotWriter implementation
+SnapshotWriter::SnapshotWriter() : buffer() {}
+
+void SnapshotWriter::writeUnsigned(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+void SnapshotWriter::writeSigned(int64_t value)
+{
+    writeUnsigned((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void SnapshotWriter::writeString(const string &value)
+{
+    writeUnsigned(value.size());
+    buffer.append(value);
+}
+
+void SnapshotWriter::writeRaw(const char *data, size_t size)
+{
+    buffer.append(data, size);
+}
+
+const string &SnapshotWriter::getBuffer() const
+{
+    return buffer;
+}
+
+size_t SnapshotWriter::size() const
+{
+    return buffer.size();
+}
+
+void SnapshotWriter::clear()
+{
+    buffer.clear();
+}
+
+// Makes a rename in the directory of path durable
+static void syncDirectory(const string &path)
+{
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int descriptor = ::open(directory.c_str(), O_RDONLY);
+    if (descriptor >= 0)
+    {
+        ::fsync(descriptor);
+        ::close(descriptor);
+    }
+}
+
+void SnapshotWriter::saveToFile(const string &path) const
+{
+    // Write next to the target, sync and rename, so neither a crash nor a power
+    // loss ever leaves half a snapshot behind
+    string tempPath = path + ".tmp";
+    int file = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+    {
+        throw std::runtime_error("Could not open snapshot file");
+    }
+    const char *data = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(file, data, remaining);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            break;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+    if (remaining > 0 || ::fsync(file) != 0)
+    {
+        ::close(file);
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Could not write snapshot file");
+    }
+    ::close(file);
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Could not write snapshot file");
+    }
+    syncDirectory(path);
+}
+
+// SnapshotReader implementation
+SnapshotReader::SnapshotReader(const char *data, size_t size) : current(data), end(data + size) {}
+
+uint64_t SnapshotReader::readUnsigned()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (current == end)
+        {
+            throw std::runtime_error("Snapshot is truncated");
+        }
+        uint8_t byte = static_cast<uint8_t>(*current++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Snapshot is corrupted");
+}
+
+int64_t SnapshotReader::readSigned()
+{
+    uint64_t value = readUnsigned();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int SnapshotReader::readInt()
+{
+    int64_t value = readSigned();
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+    {
+        throw std::runtime_error("Snapshot is corrupted");
+    }
+    return static_cast<int>(value);
+}
+
+string SnapshotReader::readString()
+{
+    uint64_t size = readUnsigned();
+    if (size > static_cast<uint64_t>(end - current))
+    {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+    string value(current, static_cast<size_t>(size));
+    current += size;
+    return value;
+}
+
+void SnapshotReader::readRaw(char *out, size_t size)
+{
+    if (size > static_cast<size_t>(end - current))
+    {
+        throw std::runtime_error("Snapshot is truncated");
+    }
+    std::memcpy(out, current, size);
+    current += size;
+}
+
+bool SnapshotReader::atEnd() const
+{
+    return current == end;
+}
+
+// MappedFile implementation
+MappedFile::MappedFile(const string &path) : address(nullptr), length(0)
+{
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat info;
+    if (::fstat(descriptor, &info) != 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Could not read " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0)
+    {
+        void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            ::close(descriptor);
+            throw std::runtime_error("Could not map " + path);
+        }
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+        address = static_cast<const char *>(mapping);
+    }
+    ::close(descriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (address != nullptr)
+    {
+        ::munmap(const_cast<char *>(address), length);
+    }
+}
+
+const char *MappedFile::data() const
+{
+    return address;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
@@ -0,0 +1,170 @@
+#include "Sweep.h"
+#include "Auxiliary.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+static bool isPolicy(const string &policy)
+{
+    return policy == "nve" || policy == "bal" || policy == "eco" || policy == "env" || policy == "config";
+}
+
+Sweep::Sweep(const string &configFilePath, const string &gridFilePath) : catalogs(), policies(), horizons(), threads(std::max(1u, std::thread::hardware_concurrency()))
+{
+    std::ifstream grid(gridFilePath);
+    if (!grid.is_open())
+    {
+        throw std::runtime_error("Could not open sweep grid " + gridFilePath);
+    }
+    catalogs.push_back(Catalog{"base", Simulation(configFilePath)});
+    string line;
+    size_t lineNumber = 0;
+    while (std::getline(grid, line))
+    {
+        ++lineNumber;
+        vector<string> arguments = Auxiliary::parseArguments(line);
+        if (arguments.empty() || arguments[0][0] == '#')
+        {
+            continue;
+        }
+        const string where = "Sweep grid line " + std::to_string(lineNumber) + ": ";
+        if (arguments[0] == "policy" && arguments.size() >= 2)
+        {
+            for (size_t i = 1; i < arguments.size(); ++i)
+            {
+                if (!isPolicy(arguments[i]))
+                {
+                    throw std::runtime_error(where + "unknown policy " + arguments[i]);
+                }
+                policies.push_back(arguments[i]);
+            }
+        }
+        else if (arguments[0] == "steps" && arguments.size() >= 2)
+        {
+            for (size_t i = 1; i < arguments.size(); ++i)
+            {
+                int steps;
+                if (!Auxiliary::parseInt(Argument{arguments[i].data(), arguments[i].size()}, steps) || steps < 0)
+                {
+                    throw std::runtime_error(where + "invalid number of steps " + arguments[i]);
+                }
+                horizons.push_back(steps);
+            }
+        }
+        else if (arguments[0] == "catalog" && arguments.size() == 3)
+        {
+            // Only the facilities are used, the settlements and plans of that config are not
+            Simulation variant(arguments[2]);
+            Catalog catalog{arguments[1], Simulation(catalogs[0].base)};
+            catalog.base.useFacilitiesOf(variant);
+            catalogs.push_back(std::move(catalog));
+        }
+        else if (arguments[0] == "threads" && arguments.size() == 2)
+        {
+            if (!Auxiliary::parseInt(Argument{arguments[1].data(), arguments[1].size()}, threads) || threads < 1)
+            {
+                throw std::runtime_error(where + "invalid thread count " + arguments[1]);
+            }
+        }
+        else
+        {
+            throw std::runtime_error(where + "expected policy, steps, catalog <name> <config_path> or threads");
+        }
+    }
+    if (horizons.empty())
+    {
+        throw std::runtime_error("Sweep grid needs a steps line");
+    }
+    if (policies.empty())
+    {
+        policies = {"nve", "bal", "eco", "env"};
+    }
+    std::sort(horizons.begin(), horizons.end());
+    horizons.erase(std::unique(horizons.begin(), horizons.end()), horizons.end());
+    for (Catalog &catalog : catalogs)
+    {
+        catalog.base.open();
+    }
+}
+
+size_t Sweep::getRunCount() const
+{
+    return catalogs.size() * policies.size();
+}
+
+int Sweep::getThreads() const
+{
+    return threads;
+}
+
+vector<Sweep::Result> Sweep::run()
+{
+    // One run per catalog and policy, each writes its own rows
+    size_t horizonCount = horizons.size();
+    vector<Result> rows(getRunCount() * horizonCount, Result{string(), string(), 0, 0, 0, 0, 0});
+    vector<char> failed(getRunCount(), false);
+    std::mutex errorLock;
+    auto runOne = [&](size_t index)
+    {
+        const Catalog &catalog = catalogs[index / policies.size()];
+        const string &policy = policies[index % policies.size()];
+        try
+        {
+            Simulation simulation(catalog.base);
+            if (policy != "config")
+            {
+                simulation.setSelectionPolicies(policy);
+            }
+            int done = 0;
+            for (size_t h = 0; h < horizonCount; ++h)
+            {
+                simulation.fastForward(horizons[h] - done, 1);
+                done = horizons[h];
+                ScoreTotals totals = simulation.getScoreTotals();
+                rows[index * horizonCount + h] = Result{catalog.name, policy, done, simulation.getPlanCount(), totals.lifeQualityScore, totals.economyScore, totals.environmentScore};
+            }
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::lock_guard<std::mutex> guard(errorLock);
+            failed[index] = true;
+            std::cerr << "Sweep run " << catalog.name << "/" << policy << " failed: " << e.what() << std::endl;
+        }
+    };
+    if (threads > 1 && getRunCount() > 1)
+    {
+        WorkStealingPool pool(static_cast<int>(std::min<size_t>(threads, getRunCount())));
+        pool.parallelFor(getRunCount(), runOne);
+    }
+    else
+    {
+        for (size_t i = 0; i < getRunCount(); ++i)
+        {
+            runOne(i);
+        }
+    }
+
+    vector<Result> results;
+    for (size_t index = 0; index < getRunCount(); ++index)
+    {
+        if (!failed[index])
+        {
+            results.insert(results.end(), rows.begin() + index * horizonCount, rows.begin() + (index + 1) * horizonCount);
+        }
+    }
+    return results;
+}
+
+void Sweep::printResults(std::ostream &out, const vector<Result> &results)
+{
+    out << "catalog,policy,steps,plans,life_quality_score,economy_score,environment_score\n";
+    for (const Result &result : results)
+    {
+        out << result.catalog << ',' << result.policy << ',' << result.steps << ',' << result.plans << ',' << result.lifeQualityScore << ','
+            << result.economyScore << ',' << result.environmentScore << '\n';
+    }
+}
@@ -0,0 +1,146 @@
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    uint64_t begin;
+    uint64_t duration;
+};
+
+struct ThreadTrace
+{
+    ThreadTrace(long threadId) : threadId(threadId), events(), dropped(0) {}
+
+    long threadId;
+    std::vector<TraceEvent> events;
+    uint64_t dropped;
+};
+
+std::atomic<bool> Tracer::enabled(false);
+
+// Sessions are numbered, a thread that recorded in an earlier one registers a new buffer
+static std::mutex registryLock;
+static std::vector<std::unique_ptr<ThreadTrace>> registry;
+static std::atomic<uint64_t> session(0);
+static std::atomic<int64_t> origin(0); // steady_clock nanoseconds at start()
+
+struct ThreadSlot
+{
+    ThreadTrace *trace;
+    uint64_t session;
+};
+
+static thread_local ThreadSlot slot = {nullptr, 0};
+
+static size_t maxEventsPerThread()
+{
+    static const size_t limit = []
+    {
+        const char *setting = std::getenv("SPL_TRACE_EVENTS");
+        char *end = nullptr;
+        unsigned long long value = setting != nullptr ? std::strtoull(setting, &end, 10) : 0;
+        return setting != nullptr && *setting != '\0' && *end == '\0' ? static_cast<size_t>(value) : Tracer::DefaultMaxEventsPerThread;
+    }();
+    return limit;
+}
+
+static int64_t clockNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ThreadTrace &threadTrace()
+{
+    uint64_t current = session.load(std::memory_order_acquire);
+    if (slot.trace == nullptr || slot.session != current)
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        registry.emplace_back(new ThreadTrace(static_cast<long>(syscall(SYS_gettid))));
+        slot.trace = registry.back().get();
+        slot.session = current;
+    }
+    return *slot.trace;
+}
+
+void Tracer::start()
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (enabled.load(std::memory_order_relaxed))
+    {
+        throw std::runtime_error("Tracing is already on");
+    }
+    registry.clear();
+    session.fetch_add(1, std::memory_order_release);
+    origin.store(clockNanoseconds(), std::memory_order_relaxed);
+    enabled.store(true, std::memory_order_release);
+}
+
+Tracer::Stats Tracer::stop(const string &path)
+{
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (!enabled.load(std::memory_order_relaxed))
+    {
+        throw std::runtime_error("Tracing is not on");
+    }
+    enabled.store(false, std::memory_order_release);
+
+    // Complete ("X") events in microseconds, one thread_name record per thread
+    Stats stats = {0, 0, registry.size()};
+    std::ofstream out(path);
+    long processId = static_cast<long>(getpid());
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    for (const std::unique_ptr<ThreadTrace> &trace : registry)
+    {
+        int length = std::snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"%s\"}}",
+                                   first ? "" : ",\n", processId, trace->threadId, trace->threadId == processId ? "main" : "worker");
+        out.write(line, std::min<int>(length, sizeof(line) - 1));
+        first = false;
+        for (const TraceEvent &event : trace->events)
+        {
+            length = std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+                                   event.name, event.category, event.begin / 1000.0, event.duration / 1000.0, processId, trace->threadId);
+            out.write(line, std::min<int>(length, sizeof(line) - 1));
+        }
+        stats.events += trace->events.size();
+        stats.dropped += trace->dropped;
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"droppedEvents\":" << stats.dropped << "}}\n";
+    registry.clear();
+    session.fetch_add(1, std::memory_order_release);
+    out.close();
+    if (!out)
+    {
+        throw std::runtime_error("Could not write trace file " + path);
+    }
+    return stats;
+}
+
+uint64_t Tracer::now()
+{
+    return static_cast<uint64_t>(clockNanoseconds() - origin.load(std::memory_order_relaxed));
+}
+
+void Tracer::record(const char *name, const char *category, uint64_t begin, uint64_t end)
+{
+    ThreadTrace &trace = threadTrace();
+    if (trace.events.size() >= maxEventsPerThread())
+    {
+        ++trace.dropped;
+        return;
+    }
+    trace.events.push_back(TraceEvent{name, category, begin, end - begin});
+}
@@ -0,0 +1,161 @@
+#include "WorkStealingPool.h"
+#include "Profiler.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int numThreads)
+    : numThreads(std::max(1, numThreads)), workers(), queues(), stateLock(), wakeWorkers(), workersDone(), job(nullptr), generation(0), activeWorkers(0), stopping(false), errorLock(), error(), errorIndex(0)
+{
+    for (int i = 0; i < this->numThreads; ++i)
+    {
+        queues.emplace_back(new WorkQueue());
+    }
+    // Worker 0 is the thread that calls parallelFor
+    for (int i = 1; i < this->numThreads; ++i)
+    {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+int WorkStealingPool::size() const
+{
+    return numThreads;
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Several small ranges per worker leave something to steal at the end
+    size_t grain = std::max<size_t>(1, count / (static_cast<size_t>(numThreads) * 8));
+    size_t queueIndex = 0;
+    for (size_t begin = 0; begin < count; begin += grain)
+    {
+        WorkQueue &queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.ranges.emplace_back(begin, std::min(count, begin + grain));
+        queueIndex = (queueIndex + 1) % queues.size();
+    }
+
+    error = nullptr;
+    errorIndex = count;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        job = &body;
+        activeWorkers = numThreads - 1;
+        ++generation;
+    }
+    wakeWorkers.notify_all();
+
+    drain(0);
+
+    {
+        std::unique_lock<std::mutex> guard(stateLock);
+        workersDone.wait(guard, [this]()
+                         { return activeWorkers == 0; });
+        job = nullptr;
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::workerLoop(int workerId)
+{
+    unsigned long seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(stateLock);
+            wakeWorkers.wait(guard, [this, seenGeneration]()
+                             { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        Profiler::attachThread(); // So the work below is counted in the caller's phase
+        drain(workerId);
+
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            --activeWorkers;
+        }
+        workersDone.notify_one();
+    }
+}
+
+void WorkStealingPool::drain(int workerId)
+{
+    std::pair<size_t, size_t> range;
+    while (takeRange(workerId, range))
+    {
+        runRange(range);
+    }
+}
+
+bool WorkStealingPool::takeRange(int workerId, std::pair<size_t, size_t> &range)
+{
+    {
+        WorkQueue &own = *queues[workerId];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.ranges.empty())
+        {
+            range = own.ranges.back();
+            own.ranges.pop_back();
+            return true;
+        }
+    }
+    for (int offset = 1; offset < numThreads; ++offset)
+    {
+        WorkQueue &victim = *queues[(workerId + offset) % numThreads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.ranges.empty())
+        {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::runRange(const std::pair<size_t, size_t> &range)
+{
+    for (size_t i = range.first; i < range.second; ++i)
+    {
+        try
+        {
+            (*job)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(errorLock);
+            if (i < errorIndex)
+            {
+                errorIndex = i;
+                error = std::current_exception();
+            }
+            return;
+        }
+    }
+}
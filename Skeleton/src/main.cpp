@@ -1,24 +1,180 @@
 #include "Simulation.h"
+#include "Sweep.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <unistd.h>
 
 using namespace std;
 
-Simulation *backup = nullptr;
+// Output buffer for script mode, flushed when full, on close and at exit
+static char scriptOutputBuffer[1 << 20];
+
+// Writes the trace --trace started, unless a `trace stop` already did
+static void finishTrace(const string &traceFile)
+{
+    if (traceFile.empty() || !Tracer::isEnabled())
+    {
+        return;
+    }
+    try
+    {
+        Tracer::Stats stats = Tracer::stop(traceFile);
+        cerr << "Trace: " << stats.events << " events from " << stats.threads << " threads (" << stats.dropped << " dropped) written to " << traceFile << endl;
+    }
+    catch (const runtime_error &e)
+    {
+        cerr << "Could not write the trace: " << e.what() << endl;
+    }
+}
+
+// Prints the results table of a sweep, see Sweep.h
+static int runSweep(const string &configurationFile, const string &sweepFile, const string &traceFile)
+{
+    try
+    {
+        auto begin = chrono::steady_clock::now();
+        Sweep sweep(configurationFile, sweepFile);
+        vector<Sweep::Result> results = sweep.run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        Sweep::printResults(cout, results);
+        cout.flush();
+        finishTrace(traceFile);
+        cerr << "Swept " << sweep.getRunCount() << " runs on " << sweep.getThreads() << " threads in " << seconds << " s" << endl;
+    }
+    catch (const exception &e)
+    {
+        cerr << "Sweep failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    string scriptFile, journalFile, traceFile, sweepFile;
+    long checkpointEvery = 100000;
+    bool validArguments = argc >= 2 && argc % 2 == 0;
+    for (int i = 2; validArguments && i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        if (option == "--script")
+        {
+            scriptFile = argv[i + 1];
+        }
+        else if (option == "--journal")
+        {
+            journalFile = argv[i + 1];
+        }
+        else if (option == "--sweep")
+        {
+            sweepFile = argv[i + 1];
+        }
+        else if (option == "--trace")
+        {
+            traceFile = argv[i + 1];
+        }
+        else if (option == "--checkpoint-every")
+        {
+            char *end = nullptr;
+            checkpointEvery = strtol(argv[i + 1], &end, 10);
+            validArguments = *end == '\0' && checkpointEvery >= 0;
+        }
+        else
+        {
+            validArguments = false;
+        }
+    }
+    // A sweep runs no commands, so it takes neither a script nor a journal
+    validArguments = validArguments && (sweepFile.empty() || (scriptFile.empty() && journalFile.empty()));
+    if (!validArguments)
     {
-        cout << "usage: simulation <config_path>" << endl;
+        cout << "usage: simulation <config_path> [--script <commands_path>] [--journal <journal_path> [--checkpoint-every <commands>]] [--trace <trace_path>]" << endl;
+        cout << "       simulation <config_path> --sweep <grid_path> [--trace <trace_path>]" << endl;
         return 0;
     }
+    if (!traceFile.empty())
+    {
+        Tracer::start(); // From the start, so the config load is traced too
+    }
+    const char *profile = getenv("SPL_PROFILE");
+    if (profile != nullptr && *profile != '\0' && string(profile) != "0")
+    {
+        Profiler::start(); // Before the config load, which is a phase of its own
+    }
     string configurationFile = argv[1];
+    if (!sweepFile.empty())
+    {
+        return runSweep(configurationFile, sweepFile, traceFile);
+    }
     Simulation simulation(configurationFile);
-    simulation.start();
-    if (backup != nullptr)
+
+    if (!journalFile.empty())
+    {
+        // Recovers a session that did not close, see Simulation::openJournal
+        try
+        {
+            auto begin = chrono::steady_clock::now();
+            uint64_t replayed = simulation.openJournal(journalFile, static_cast<size_t>(checkpointEvery));
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            if (replayed > 0)
+            {
+                cerr << "Recovered " << replayed << " commands from " << journalFile << " in " << seconds << " s" << endl;
+            }
+        }
+        catch (const runtime_error &e)
+        {
+            cerr << "Could not recover the journal: " << e.what() << endl;
+            return 1;
+        }
+    }
+
+    // Commands piped in or read from a script run without prompts and with buffered output
+    bool scripted = !scriptFile.empty() || !isatty(STDIN_FILENO);
+    if (!scripted)
+    {
+        simulation.start();
+        finishTrace(traceFile);
+        return 0;
+    }
+
+    ifstream script;
+    if (!scriptFile.empty())
+    {
+        script.open(scriptFile);
+        if (!script.is_open())
+        {
+            cerr << "Could not open script file" << endl;
+            return 1;
+        }
+    }
+    setvbuf(stdout, scriptOutputBuffer, _IOFBF, sizeof(scriptOutputBuffer));
+    auto begin = chrono::steady_clock::now();
+    long commands = simulation.runScript(!scriptFile.empty() ? script : cin);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    fflush(stdout);
+    finishTrace(traceFile);
+    const ConfigLoadStats &load = simulation.getConfigLoadStats();
+    cerr << "Loaded " << load.lines << " config lines (" << load.bytes / 1e6 << " MB) in " << load.seconds << " s on " << load.threads << " threads ("
+         << (load.seconds > 0 ? load.bytes / 1e6 / load.seconds : 0) << " MB/s)" << endl;
+    BalancedDecisionCache::Stats decisions = simulation.getBalancedDecisionStats();
+    size_t lookups = decisions.hits + decisions.misses;
+    cerr << "Balanced decisions: " << decisions.hits << " hits, " << decisions.misses << " misses (" << (lookups > 0 ? 100.0 * decisions.hits / lookups : 0)
+         << "% hit rate), " << decisions.entries << " cached, " << decisions.invalidations << " invalidations" << endl;
+    if (const Journal *journal = simulation.getJournal())
+    {
+        Journal::Stats stats = journal->getStats();
+        cerr << "Journal: " << stats.records << " records, " << stats.syncs << " syncs, " << stats.checkpoints << " checkpoints" << endl;
+    }
+    if (Profiler::isEnabled())
     {
-        delete backup;
-        backup = nullptr;
+        Profiler::print(cerr);
     }
+    cerr << "Processed " << commands << " commands in " << seconds << " s (" << (seconds > 0 ? commands / seconds : 0) << " commands/s)" << endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,74 @@
+#!/bin/bash
+# Crash recovery checks for --journal. Every session below ends without
+# `close`, as a killed process would, and the next one has to recover it.
+# usage: tests/journal_recovery.sh [simulation binary] (bin/simulation by default)
+
+SIMULATION=${1:-bin/simulation}
+CONFIG=$(dirname "$0")/../config_file.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+# Runs the simulation on the commands in $1 with the remaining arguments, keeps
+# its output without the start banner
+run()
+{
+    local commands=$1
+    shift
+    "$SIMULATION" "$CONFIG" "$@" < "$commands" 2>/dev/null | grep -v "simulation has started"
+}
+
+check()
+{
+    if [ "$2" == "0" ]; then
+        echo "PASS $1"
+    else
+        echo "FAIL $1"
+        FAILED=1
+    fi
+}
+
+printf 'step 2\nplan BeitSPL nve\nstep 3\nchangePolicy 0 env\nbackup\nstep 1\n' > "$WORK/first.txt"
+printf 'planStatus 1\nstep 4\nrestore\nplan KfarSPL bal\nstep 2\n' > "$WORK/second.txt"
+printf 'planStatus 0\nplanStatus 1\nplanStatus 2\nplanStatus 3\nlog\nclose\n' > "$WORK/last.txt"
+cat "$WORK/first.txt" "$WORK/second.txt" "$WORK/last.txt" > "$WORK/all.txt"
+run "$WORK/all.txt" > "$WORK/expected.txt"
+
+# A record torn by a crash mid-write is cut off, and the rest is replayed
+rm -f "$WORK/torn.jnl"*
+{
+    run "$WORK/first.txt" --journal "$WORK/torn.jnl"
+    printf '99999 step 1' >> "$WORK/torn.jnl"
+    run "$WORK/second.txt" --journal "$WORK/torn.jnl"
+    grep -q '^99999 ' "$WORK/torn.jnl" && echo "torn record kept"
+    run "$WORK/last.txt" --journal "$WORK/torn.jnl"
+} > "$WORK/torn.txt"
+cmp -s "$WORK/torn.txt" "$WORK/expected.txt"
+check "torn record" $?
+
+# Records a checkpoint covers are skipped, as after a crash between writing
+# the checkpoint and emptying the journal
+rm -f "$WORK/stale.jnl"*
+{
+    run "$WORK/first.txt" --journal "$WORK/stale.jnl" --checkpoint-every 0
+    cp "$WORK/stale.jnl" "$WORK/covered.jnl"
+    run "$WORK/second.txt" --journal "$WORK/stale.jnl" --checkpoint-every 3
+    [ -f "$WORK/stale.jnl.checkpoint" ] || echo "no checkpoint written"
+    cat "$WORK/covered.jnl" "$WORK/stale.jnl" > "$WORK/both.jnl"
+    mv "$WORK/both.jnl" "$WORK/stale.jnl"
+    run "$WORK/last.txt" --journal "$WORK/stale.jnl" --checkpoint-every 3
+} > "$WORK/stale.txt"
+cmp -s "$WORK/stale.txt" "$WORK/expected.txt"
+check "checkpoint skip" $?
+
+# Replaying a command redoes its effect on the simulation only, never on files
+rm -f "$WORK/files.jnl"*
+printf 'step 3\nsave %s\nstep 4\n' "$WORK/saved.snap" > "$WORK/save.txt"
+printf 'close\n' > "$WORK/close.txt"
+run "$WORK/save.txt" --journal "$WORK/files.jnl" > /dev/null
+echo edited > "$WORK/saved.snap"
+run "$WORK/close.txt" --journal "$WORK/files.jnl" > /dev/null
+[ "$(cat "$WORK/saved.snap")" == "edited" ]
+check "replay leaves saved files alone" $?
+
+exit $FAILED